@@ -7,19 +7,6 @@ double sec(){
     return t.tv_sec + 1e-9 * t.tv_nsec;
 }
 
-struct IntersectionCallback {
-    size_t count;
-
-    IntersectionCallback(): count(0){}
-
-    void operator () (
-        const Point &,
-        const std::vector<const Segment*> &
-    ){
-        count++;
-    }
-};
-
 int main(){
     for (size_t n = 500; n <= 10000; n += 500){
         std::vector<Segment> segments;
@@ -38,13 +25,15 @@ int main(){
 
         double start_time = sec();
 
-        IntersectionCallback callback;
+        SegmentsView view(segments);
+        Sweepline<SegmentsView> sweep(view);
 
-        find_intersections_sweepline(segments, callback);
+        size_t count = 0;
+        while (sweep.next()) count++;
 
         double elapsed_time = sec() - start_time;
 
-        std::cout << n << " segments " << callback.count << " intersections " << elapsed_time << " seconds" << std::endl;
+        std::cout << n << " segments " << count << " intersections " << elapsed_time << " seconds " << sweep.stats << std::endl;
     }
 
     return 0;
@@ -0,0 +1,35 @@
+#include "sweepline.hpp"
+#include <sstream>
+
+int main(){
+    SegmentArrays<int64_t> segments;
+
+    for (int64_t i = 0; i < 10; i++){
+        segments.push_back(0, i, 10, i + 1);
+    }
+    segments.push_back(10, 0, 0, 10);
+
+    std::stringstream snapshot;
+
+    // Stop after the first few intersections and save the state
+    {
+        Sweepline<SegmentArrays<int64_t>> sweep(segments);
+
+        for (int i = 0; i < 3 && sweep.next(); i++){
+            std::cout << "Intersection at " << sweep.event_point << std::endl;
+        }
+
+        sweep.save(snapshot);
+    }
+
+    // Continue later, e.g. in another process
+    Sweepline<SegmentArrays<int64_t>> sweep(segments);
+
+    if (!sweep.load(snapshot)) return 1;
+
+    while (sweep.next()){
+        std::cout << "Intersection at " << sweep.event_point << " after resuming" << std::endl;
+    }
+
+    return 0;
+}
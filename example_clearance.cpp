@@ -0,0 +1,29 @@
+#include "sweepline.hpp"
+
+struct ClearanceCallback {
+    void operator () (
+        SegmentId i,
+        SegmentId j,
+        const Point &p,
+        const Point &q,
+        const Fraction &squared_distance
+    ){
+        std::cout << "Segments " << i << " and " << j << " have squared distance " << squared_distance;
+        std::cout << " between " << p << " and " << q << std::endl;
+    }
+};
+
+int main(){
+    SegmentArrays<int64_t> segments;
+
+    segments.push_back(0, 0, 10, 0);
+    segments.push_back(3, 1, 5, 4);
+    segments.push_back(12, 1, 12, 5);
+
+    ClearanceCallback callback;
+
+    // Report all pairs of segments which are at most 2 apart
+    find_segments_within_distance(segments, 2, callback);
+
+    return 0;
+}
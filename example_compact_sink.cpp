@@ -0,0 +1,29 @@
+#include "sweepline.hpp"
+
+int main(){
+    SegmentArrays<int64_t> segments;
+
+    for (int64_t i = 0; i < 100; i++){
+        segments.push_back(0, i, 100, i + 1);
+    }
+    segments.push_back(100, 0, 0, 100);
+
+    // Keep at most 1 KiB in memory and spill the rest to a file
+    {
+        CompactIntersectionSink sink(1024, "intersections.bin");
+
+        find_intersections_sweepline(segments, sink);
+
+        sink.finish();
+    }
+
+    CompactIntersectionReader reader("intersections.bin");
+
+    while (reader.next()){
+        std::cout << "Intersection at " << reader.event_point << " between " << reader.intersecting_segments.size() << " segments" << std::endl;
+    }
+
+    std::remove("intersections.bin");
+
+    return 0;
+}
@@ -0,0 +1,23 @@
+#include "sweepline.hpp"
+
+int main(){
+    SegmentArrays<int64_t> segments;
+
+    for (int64_t i = 0; i < 1000; i++){
+        segments.push_back(0, i, 1000, i + 1);
+    }
+    segments.push_back(1000, 0, 0, 1000);
+
+    Sweepline<SegmentArrays<int64_t>> sweep(segments);
+
+    // Only compute the first few intersections
+    for (int i = 0; i < 3 && sweep.next(); i++){
+        std::cout << "Intersection at " << sweep.event_point << " between segments";
+        for (SegmentId id : sweep.intersecting_segments){
+            std::cout << " " << id;
+        }
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
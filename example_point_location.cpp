@@ -0,0 +1,24 @@
+#include "sweepline.hpp"
+
+int main(){
+    SegmentArrays<int64_t> segments;
+    segments.push_back(0, 0, 4, 4);
+    segments.push_back(0, 4, 4, 0);
+    segments.push_back(0, 5, 4, 5);
+
+    VerticalDecomposition<SegmentArrays<int64_t>> decomposition(segments);
+
+    Points points = {Point(1, 2), Point(2, 2), Point(3, 4), Point(5, 1)};
+    std::vector<PointLocation> results;
+    decomposition.locate(points, results);
+
+    for (size_t i = 0; i < points.size(); i++){
+        std::cout << "Point " << points[i] << " is";
+        if (results[i].on_segment) std::cout << " on segment " << results[i].below;
+        else if (results[i].below != NO_SEGMENT) std::cout << " above segment " << results[i].below;
+        if (results[i].above != NO_SEGMENT) std::cout << " below segment " << results[i].above;
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
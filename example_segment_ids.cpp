@@ -0,0 +1,28 @@
+#include "sweepline.hpp"
+
+struct IntersectionCallback {
+    void operator () (
+        const Point &intersection,
+        const SegmentIds &segment_ids
+    ){
+        std::cout << "New intersection at " << intersection << " between segments";
+        for (SegmentId id : segment_ids){
+            std::cout << " " << id;
+        }
+        std::cout << std::endl;
+    }
+};
+
+int main(){
+    SegmentArrays<int64_t> segments;
+
+    segments.push_back(0, 0, 1, 1);
+    segments.push_back(1, 0, 0, 1);
+    segments.push_back(0, 1, 1, 0);
+
+    IntersectionCallback callback;
+
+    find_intersections_sweepline(segments, callback);
+
+    return 0;
+}
@@ -14,7 +14,10 @@ struct IntersectionCallback {
     }
 };
 
-int main(){
+int main(int argc, char **argv){
+    // --general uses the general sweep also for horizontal and vertical segments
+    bool allow_orthogonal = !(argc > 1 && std::string(argv[1]) == "--general");
+
     std::cout <<
         "Enter segments as 4 numbers. For example, the segment "
         "((1, 2), (3, 4)) should be entered as 1 2 3 4. Press "
@@ -32,7 +35,7 @@ int main(){
 
     IntersectionCallback callback;
 
-    find_intersections_sweepline(segments, callback);
+    find_intersections_sweepline(segments, callback, allow_orthogonal);
 
     return 0;
 }
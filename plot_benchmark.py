@@ -10,7 +10,7 @@ def main():
     y = []
     for line in output.decode("utf-8").strip().split("\n"):
         print(line)
-        num_segments, _, num_intersections, _, elapsed_time, _ = line.split()
+        num_segments, _, num_intersections, _, elapsed_time, _ = line.split()[:6]
         x.append(int(num_segments))
         y.append(float(elapsed_time))
 
@@ -0,0 +1,328 @@
+#pragma once
+
+#include <stdint.h>
+#include <assert.h>
+#include <math.h>
+#include <iostream>
+#include <utility>
+#include <gmpxx.h>
+
+// Exact rational number with the same results as mpq_class.
+//
+// Numerator and denominator are stored inline as int64_t as long as both fit,
+// intermediate products are computed with __int128 and the value is only
+// moved to a heap-allocated mpq_class if the reduced result does not fit.
+// Values which fit are always stored inline, so the representation of every
+// value is unique and small values never touch GMP.
+//
+// The numerator is never INT64_MIN so that it can always be negated.
+class SmallFraction {
+public:
+    SmallFraction(): num(0), den(1), big(nullptr){}
+
+    SmallFraction(int x): num(x), den(1), big(nullptr){}
+
+    SmallFraction(long x): big(nullptr){
+        set_integer(x);
+    }
+
+    SmallFraction(long long x): big(nullptr){
+        set_integer(x);
+    }
+
+    SmallFraction(unsigned x): num(x), den(1), big(nullptr){}
+
+    SmallFraction(unsigned long x): big(nullptr){
+        set_unsigned(x);
+    }
+
+    SmallFraction(unsigned long long x): big(nullptr){
+        set_unsigned(x);
+    }
+
+    SmallFraction(double x): big(nullptr){
+        if (x == floor(x) && fabs(x) < 9.2e18){
+            set_integer((long long)x);
+        }else{
+            set_big(mpq_class(x));
+        }
+    }
+
+    SmallFraction(const mpq_class &x): big(nullptr){
+        set_big(x);
+    }
+
+    SmallFraction(const SmallFraction &x): num(x.num), den(x.den), big(x.big ? new mpq_class(*x.big) : nullptr){}
+
+    SmallFraction(SmallFraction &&x): num(x.num), den(x.den), big(x.big){
+        x.big = nullptr;
+    }
+
+    ~SmallFraction(){
+        delete big;
+    }
+
+    SmallFraction& operator = (const SmallFraction &x){
+        if (x.big){
+            if (big) *big = *x.big; else big = new mpq_class(*x.big);
+        }else{
+            delete big;
+            big = nullptr;
+            num = x.num;
+            den = x.den;
+        }
+        return *this;
+    }
+
+    SmallFraction& operator = (SmallFraction &&x){
+        std::swap(num, x.num);
+        std::swap(den, x.den);
+        std::swap(big, x.big);
+        return *this;
+    }
+
+    bool is_small() const {
+        return big == nullptr;
+    }
+
+    mpq_class get_mpq() const {
+        if (big) return *big;
+
+        mpq_class q;
+        mpz_set_si(mpq_numref(q.get_mpq_t()), num);
+        mpz_set_si(mpq_denref(q.get_mpq_t()), den);
+        return q;
+    }
+
+    // Numerator and denominator if they fit into int64_t
+    bool get_int64(int64_t &n, int64_t &d) const {
+        if (big) return false;
+        n = num;
+        d = den;
+        return true;
+    }
+
+    double get_d() const {
+        return big ? big->get_d() : double(num) / double(den);
+    }
+
+    int sign() const {
+        if (big) return sgn(*big);
+        return (num > 0) - (num < 0);
+    }
+
+    SmallFraction operator - () const {
+        if (big) return SmallFraction(mpq_class(-*big));
+
+        SmallFraction result;
+        result.num = -num;
+        result.den = den;
+        return result;
+    }
+
+    SmallFraction& operator += (const SmallFraction &x){
+        if (big || x.big){
+            set_big(get_mpq() + x.get_mpq());
+        }else if (den == 1 && x.den == 1){
+            int64_t n;
+            if (__builtin_add_overflow(num, x.num, &n) || n == INT64_MIN){
+                set_reduced(__int128(num) + x.num, 1);
+            }else{
+                num = n;
+            }
+        }else{
+            // Knuth, TAOCP Vol. 2, 4.5.1: keep intermediate values small by
+            // only multiplying with the parts of the denominators which differ
+            int64_t d1 = gcd(den, x.den);
+            if (d1 == 1){
+                set_reduced(__int128(num) * x.den + __int128(x.num) * den, __int128(den) * x.den);
+            }else{
+                int64_t b = den / d1;
+                int64_t d = x.den / d1;
+                __int128 t = __int128(num) * d + __int128(x.num) * b;
+                int64_t d2 = gcd(uint64_abs(t % d1), d1);
+                set_reduced(t / d2, __int128(b) * (x.den / d2));
+            }
+        }
+        return *this;
+    }
+
+    SmallFraction& operator -= (const SmallFraction &x){
+        return *this += -x;
+    }
+
+    SmallFraction& operator *= (const SmallFraction &x){
+        if (big || x.big){
+            set_big(get_mpq() * x.get_mpq());
+        }else if (num == 0 || x.num == 0){
+            num = 0;
+            den = 1;
+        }else{
+            // Cancel common factors before multiplying so the result is reduced
+            int64_t g1 = gcd(uint64_abs(num), x.den);
+            int64_t g2 = gcd(uint64_abs(x.num), den);
+            set_reduced(
+                __int128(num / g1) * (x.num / g2),
+                __int128(den / g2) * (x.den / g1));
+        }
+        return *this;
+    }
+
+    SmallFraction& operator /= (const SmallFraction &x){
+        assert(x.sign() != 0);
+
+        if (big || x.big){
+            set_big(get_mpq() / x.get_mpq());
+            return *this;
+        }
+
+        SmallFraction reciprocal;
+        reciprocal.num = x.num < 0 ? -x.den : x.den;
+        reciprocal.den = x.num < 0 ? -x.num : x.num;
+        return *this *= reciprocal;
+    }
+
+    friend bool operator == (const SmallFraction &x, const SmallFraction &y){
+        if (x.big && y.big) return *x.big == *y.big;
+        if (x.big || y.big) return false;
+        return x.num == y.num && x.den == y.den;
+    }
+
+    friend bool operator < (const SmallFraction &x, const SmallFraction &y){
+        if (x.big || y.big) return x.get_mpq() < y.get_mpq();
+        if (x.den == y.den) return x.num < y.num;
+        return __int128(x.num) * y.den < __int128(y.num) * x.den;
+    }
+
+    friend std::ostream& operator << (std::ostream &out, const SmallFraction &x){
+        if (x.big){
+            out << *x.big;
+        }else{
+            out << x.num;
+            if (x.den != 1) out << "/" << x.den;
+        }
+        return out;
+    }
+
+    friend std::istream& operator >> (std::istream &in, SmallFraction &x){
+        mpq_class q;
+        if (in >> q){
+            q.canonicalize();
+            x.set_big(q);
+        }
+        return in;
+    }
+
+private:
+    int64_t num, den;
+    mpq_class *big;
+
+    static uint64_t uint64_abs(__int128 x){
+        return x < 0 ? -x : x;
+    }
+
+    static int64_t gcd(uint64_t a, uint64_t b){
+        // Binary GCD
+        if (a == 0) return b;
+        if (b == 0) return a;
+
+        int shift = __builtin_ctzll(a | b);
+        a >>= __builtin_ctzll(a);
+        do {
+            b >>= __builtin_ctzll(b);
+            if (a > b) std::swap(a, b);
+            b -= a;
+        } while (b != 0);
+
+        return a << shift;
+    }
+
+    static bool fits(__int128 x){
+        return x > INT64_MIN && x <= INT64_MAX;
+    }
+
+    static mpz_class to_mpz(__int128 x){
+        unsigned __int128 magnitude = x < 0 ? -(unsigned __int128)x : x;
+        uint64_t words[2] = {uint64_t(magnitude), uint64_t(magnitude >> 64)};
+
+        mpz_class z;
+        mpz_import(z.get_mpz_t(), 2, -1, sizeof(uint64_t), 0, 0, words);
+        if (x < 0) z = -z;
+        return z;
+    }
+
+    void set_integer(long long x){
+        if (x == INT64_MIN){
+            set_big(mpq_class(mpz_class(to_mpz(x))));
+        }else{
+            delete big;
+            big = nullptr;
+            num = x;
+            den = 1;
+        }
+    }
+
+    void set_unsigned(unsigned long long x){
+        if (x > INT64_MAX){
+            set_big(mpq_class(mpz_class(to_mpz(x))));
+        }else{
+            set_integer(x);
+        }
+    }
+
+    // n / d must already be reduced and d > 0
+    void set_reduced(__int128 n, __int128 d){
+        if (fits(n) && fits(d)){
+            delete big;
+            big = nullptr;
+            num = n;
+            den = d;
+        }else{
+            mpq_class q;
+            q.get_num() = to_mpz(n);
+            q.get_den() = to_mpz(d);
+            set_big(q);
+        }
+    }
+
+    // x must be canonical
+    void set_big(const mpq_class &x){
+        const mpz_class &n = x.get_num();
+        const mpz_class &d = x.get_den();
+
+        if (n.fits_slong_p() && d.fits_slong_p() && sizeof(long) == sizeof(int64_t) && n.get_si() != INT64_MIN){
+            int64_t small_num = n.get_si();
+            int64_t small_den = d.get_si();
+            delete big;
+            big = nullptr;
+            num = small_num;
+            den = small_den;
+        }else if (big){
+            *big = x;
+        }else{
+            big = new mpq_class(x);
+        }
+    }
+};
+
+inline bool operator != (const SmallFraction &x, const SmallFraction &y){ return !(x == y); }
+inline bool operator >  (const SmallFraction &x, const SmallFraction &y){ return y < x; }
+inline bool operator <= (const SmallFraction &x, const SmallFraction &y){ return !(y < x); }
+inline bool operator >= (const SmallFraction &x, const SmallFraction &y){ return !(x < y); }
+
+inline SmallFraction operator + (SmallFraction x, const SmallFraction &y){ return x += y; }
+inline SmallFraction operator - (SmallFraction x, const SmallFraction &y){ return x -= y; }
+inline SmallFraction operator * (SmallFraction x, const SmallFraction &y){ return x *= y; }
+inline SmallFraction operator / (SmallFraction x, const SmallFraction &y){ return x /= y; }
+
+inline SmallFraction abs(const SmallFraction &x){
+    return x.sign() < 0 ? -x : x;
+}
+
+inline mpq_class to_mpq(const SmallFraction &x){
+    return x.get_mpq();
+}
+
+inline bool get_int64(const SmallFraction &x, int64_t &num, int64_t &den){
+    return x.get_int64(num, den);
+}
@@ -1,5 +1,5 @@
-#include "intrusive_list.hpp"
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <vector>
@@ -8,10 +8,33 @@
 #include <numeric>
 #include <set>
 #include <map>
+#include <string>
+#include <stdexcept>
+#include <thread>
 #include <gmpxx.h>
 
+// Define SWEEPLINE_USE_MPQ to compute with mpq_class directly instead of
+// SmallFraction, which only falls back to mpq_class for large values.
+#ifdef SWEEPLINE_USE_MPQ
 typedef mpq_class Fraction;
 
+inline const mpq_class& to_mpq(const mpq_class &x){
+    return x;
+}
+
+inline bool get_int64(const mpq_class &x, int64_t &num, int64_t &den){
+    if (sizeof(long) < sizeof(int64_t)) return false;
+    if (!x.get_num().fits_slong_p() || !x.get_den().fits_slong_p()) return false;
+    num = x.get_num().get_si();
+    den = x.get_den().get_si();
+    return true;
+}
+#else
+#include "small_fraction.hpp"
+
+typedef SmallFraction Fraction;
+#endif
+
 struct Point {
     Fraction x, y;
 
@@ -84,12 +107,6 @@ bool between(Fraction a, Fraction x, Fraction b){
 
 struct Segment {
     Point a, b;
-    IntrusiveNode<Segment> node;
-    IntrusiveNode<Segment> end_node;
-
-    Segment(const Segment &seg): a(seg.a), b(seg.b){
-        assert(seg.node.unlinked());
-    }
 
     Segment(const Point &a, const Point &b):
         a(a), b(b){}
@@ -118,6 +135,93 @@ bool operator == (const Segment &seg0, const Segment &seg1){
     return seg0.a == seg1.a && seg0.b == seg1.b;
 }
 
+typedef uint32_t SegmentId;
+typedef std::vector<SegmentId> SegmentIds;
+
+const SegmentId NO_SEGMENT = UINT32_MAX;
+
+// Segments stored as structure of arrays. Coordinate can be any type which
+// converts exactly to Fraction, e.g. int64_t, double or Fraction itself.
+// Compared to std::vector<Segment>, this avoids one heap allocation per
+// numerator and denominator when coordinates are integers or doubles.
+template <typename Coordinate>
+struct SegmentArrays {
+    std::vector<Coordinate> ax, ay, bx, by;
+
+    void push_back(
+        const Coordinate &ax,
+        const Coordinate &ay,
+        const Coordinate &bx,
+        const Coordinate &by
+    ){
+        this->ax.push_back(ax);
+        this->ay.push_back(ay);
+        this->bx.push_back(bx);
+        this->by.push_back(by);
+    }
+
+    size_t size() const {
+        return ax.size();
+    }
+
+    Point a(SegmentId id) const {
+        return Point(Fraction(ax[id]), Fraction(ay[id]));
+    }
+
+    Point b(SegmentId id) const {
+        return Point(Fraction(bx[id]), Fraction(by[id]));
+    }
+};
+
+// Adapts std::vector<Segment> to the interface of SegmentArrays
+struct SegmentsView {
+    const Segments &segments;
+
+    SegmentsView(const Segments &segments): segments(segments){}
+
+    size_t size() const {
+        return segments.size();
+    }
+
+    const Point& a(SegmentId id) const {
+        return segments[id].a;
+    }
+
+    const Point& b(SegmentId id) const {
+        return segments[id].b;
+    }
+};
+
+// Endpoints of segments ordered such that start(id) <= end(id).
+// Only a single bit per segment is stored, the input remains unchanged.
+template <typename SEGMENTS>
+struct OrientedSegments {
+    const SEGMENTS &segments;
+    std::vector<bool> reversed;
+
+    OrientedSegments(const SEGMENTS &segments): segments(segments), reversed(segments.size()){
+        for (SegmentId id = 0; id < segments.size(); id++){
+            reversed[id] = segments.b(id) < segments.a(id);
+        }
+    }
+
+    size_t size() const {
+        return segments.size();
+    }
+
+    Point start(SegmentId id) const {
+        return reversed[id] ? segments.b(id) : segments.a(id);
+    }
+
+    Point end(SegmentId id) const {
+        return reversed[id] ? segments.a(id) : segments.b(id);
+    }
+
+    Segment segment(SegmentId id) const {
+        return Segment(start(id), end(id));
+    }
+};
+
 template <typename Iterator, typename Value>
 bool contains(Iterator a, Iterator b, const Value &value){
     for (; a != b; ++a){
@@ -196,6 +300,55 @@ void find_intersections_two_segments(Point a, Point b, Point c, Point d, Points
     }
 }
 
+// Closest point to p on segment (a, b)
+Point closest_point_on_segment(const Point &p, const Point &a, const Point &b){
+    Point ba = b - a;
+    Fraction ba2 = dot(ba, ba);
+
+    if (ba2 == 0) return a;
+
+    Fraction t = dot(p - a, ba) / ba2;
+
+    if (t <= 0) return a;
+    if (t >= 1) return b;
+
+    return a + t * ba;
+}
+
+// Squared distance between segments (a, b) and (c, d) with a <= b and c <= d.
+// Also computes the closest points p on (a, b) and q on (c, d).
+Fraction squared_distance_two_segments(Point a, Point b, Point c, Point d, Point &p, Point &q){
+    Points intersections;
+    find_intersections_two_segments(a, b, c, d, intersections);
+
+    if (!intersections.empty()){
+        p = q = intersections[0];
+        return 0;
+    }
+
+    // If the segments do not intersect, one of the closest points is an end point
+    Point candidates[4][2] = {
+        {a, closest_point_on_segment(a, c, d)},
+        {b, closest_point_on_segment(b, c, d)},
+        {closest_point_on_segment(c, a, b), c},
+        {closest_point_on_segment(d, a, b), d},
+    };
+
+    Fraction min_distance2;
+    for (int i = 0; i < 4; i++){
+        Point diff = candidates[i][1] - candidates[i][0];
+        Fraction distance2 = dot(diff, diff);
+
+        if (i == 0 || distance2 < min_distance2){
+            min_distance2 = distance2;
+            p = candidates[i][0];
+            q = candidates[i][1];
+        }
+    }
+
+    return min_distance2;
+}
+
 bool operator == (const Points &points1, const Points &points2){
     if (points1.size() != points2.size()) return false;
     for (size_t i = 0; i < points1.size(); i++){
@@ -234,8 +387,10 @@ struct SweepKey {
             key = Point{y, (y < ey) ? slope : -slope};
         }
 
-        // The order of segments intersecting the event_point reverses after the event_point
-        if (after_event_point){
+        // The order of segments intersecting the event_point reverses after the event_point.
+        // Other segments keep their order, which allows to rebuild the whole
+        // sweepline after an event_point, see Sweepline::load.
+        if (after_event_point && key.x == ey){
             key.y = -key.y;
         }
 
@@ -253,99 +408,430 @@ struct SegmentComparator {
     }
 };
 
-typedef IntrusiveList<Segment, &Segment::node> SegmentList;
-typedef IntrusiveList<Segment, &Segment::end_node> EndList;
-
 struct Event {
-    SegmentList start_segments;
-    EndList end_segments;
-};
+    SegmentIds start_segments;
 
-void add_intersections_as_event_points(
-    std::map<Point, Event> &event_queue,
-    Points &tmp_intersections,
-    const Point &event_point,
-    const Segment &seg0,
-    const Segment &seg1
-){
-    tmp_intersections.clear();
-    find_intersections_two_segments(seg0.a, seg0.b, seg1.a, seg1.b, tmp_intersections);
+    // Number of segments starting or ending here plus the number of
+    // neighboring SweepSegments intersecting here (only counted with
+    // Sweepline::linear_event_queue). The event can be removed at zero.
+    size_t num_references = 0;
+};
 
-    for (Point intersection : tmp_intersections){
-        if (intersection > event_point){
-            event_queue[intersection];
-        }
-    }
-}
+typedef std::map<Point, Event> EventQueue;
 
 struct SweepSegment : Segment {
-    SegmentList parallel_segments;
+    // Collinear overlapping segments are merged into a single SweepSegment
+    SegmentIds segment_ids;
 
-    SweepSegment(const Point &a, const Point &b): Segment(a, b){}
+    // Id of the segment which was added last. Since a and b only change when
+    // a segment is added, this identifies the geometry of the SweepSegment.
+    SegmentId version = 0;
 
-    SweepSegment(const SweepSegment &s): Segment(s.a, s.b){
-        SweepSegment &todo_remove_ugly_hack = *(SweepSegment*)&s;
-        parallel_segments.steal(todo_remove_ugly_hack.parallel_segments);
-    }
+    // Intersections with the SweepSegment above, see Sweepline::linear_event_queue.
+    // Mutable since it is not part of the order of the sweepline.
+    mutable std::vector<EventQueue::iterator> upper_events;
 
-    SweepSegment& operator = (const SweepSegment &s){
-        a = s.a;
-        b = s.b;
-        return *this;
-    }
+    // Versions of the neighbors below and above which were tested last, see Sweepline::add_intersections.
+    // Mutable since they are not part of the order of the sweepline.
+    mutable SegmentId tested_lower = NO_SEGMENT;
+    mutable SegmentId tested_upper = NO_SEGMENT;
+
+    SweepSegment(const Point &a, const Point &b): Segment(a, b){}
 
-    void add(Segment &seg){
+    void add(SegmentId id, const Segment &seg){
         a = std::min(a, seg.a);
         b = std::max(b, seg.b);
 
-        parallel_segments.push_back(seg);
+        segment_ids.push_back(id);
+        version = id;
+
+        // Tests with neighbors were done with the old geometry
+        tested_lower = NO_SEGMENT;
+        tested_upper = NO_SEGMENT;
+    }
+};
+
+struct SweepStats {
+    size_t max_sweepline_size = 0;
+    size_t max_event_queue_size = 0;
+    // Exact intersection tests between neighboring SweepSegments
+    size_t num_intersection_tests = 0;
+    // Tests skipped because the same pair had already been tested
+    size_t num_cached_intersection_tests = 0;
+
+    double cache_hit_rate() const {
+        size_t total = num_intersection_tests + num_cached_intersection_tests;
+        return total > 0 ? double(num_cached_intersection_tests) / total : 0.0;
     }
 };
 
+std::ostream& operator << (std::ostream &out, const SweepStats &stats) {
+    out << "max sweepline size " << stats.max_sweepline_size
+        << " max event queue size " << stats.max_event_queue_size
+        << " intersection tests " << stats.num_intersection_tests
+        << " cached " << stats.num_cached_intersection_tests
+        << " cache hit rate " << stats.cache_hit_rate();
+    return out;
+}
+
+// Binary snapshot helpers. Integers are stored as varints, fractions as
+// numerator and denominator with their magnitude in big endian bytes.
+// OUTPUT needs put(char) and write(const char*, size_t) like std::ostream,
+// INPUT needs get() and read(char*, size_t) like std::istream.
+template <typename OUTPUT>
+void write_varint(OUTPUT &out, uint64_t value){
+    while (value >= 0x80){
+        out.put(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.put(char(value));
+}
 
-template <typename INTERSECTION_CALLBACK>
-void find_intersections_sweepline(Segments &segments, INTERSECTION_CALLBACK &callback){
-    std::map<Point, Event> event_queue;
+template <typename INPUT>
+bool read_varint(INPUT &in, uint64_t &value){
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7){
+        int c = in.get();
+        if (c == EOF) return false;
+        value |= uint64_t(c & 0x7f) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+template <typename OUTPUT>
+void write_integer(OUTPUT &out, const mpz_class &x){
+    std::vector<unsigned char> bytes((mpz_sizeinbase(x.get_mpz_t(), 2) + 7) / 8);
+    size_t n = 0;
+    mpz_export(bytes.data(), &n, 1, 1, 1, 0, x.get_mpz_t());
+
+    write_varint(out, 2 * n + (sgn(x) < 0));
+    out.write((const char*)bytes.data(), n);
+}
+
+template <typename INPUT>
+bool read_integer(INPUT &in, mpz_class &x){
+    uint64_t header;
+    if (!read_varint(in, header)) return false;
+
+    // The length is untrusted, so only grow the buffer as bytes arrive
+    uint64_t n = header / 2;
+    std::vector<unsigned char> bytes;
+    while (bytes.size() < n){
+        size_t offset = bytes.size();
+        size_t chunk_size = std::min<uint64_t>(n - offset, 1 << 16);
+        bytes.resize(offset + chunk_size);
+        if (!in.read((char*)bytes.data() + offset, chunk_size)) return false;
+    }
+
+    mpz_import(x.get_mpz_t(), bytes.size(), 1, 1, 1, 0, bytes.data());
+    if (header & 1) x = -x;
+    return true;
+}
+
+template <typename OUTPUT>
+void write_fraction(OUTPUT &out, const Fraction &x){
+    const mpq_class &q = to_mpq(x);
+    write_integer(out, q.get_num());
+    write_integer(out, q.get_den());
+}
+
+template <typename INPUT>
+bool read_fraction(INPUT &in, Fraction &x){
+    mpq_class q;
+    if (!read_integer(in, q.get_num())) return false;
+    if (!read_integer(in, q.get_den())) return false;
+    if (q.get_den() <= 0) return false;
+    q.canonicalize();
+    x = Fraction(q);
+    return true;
+}
+
+template <typename OUTPUT>
+void write_point(OUTPUT &out, const Point &p){
+    write_fraction(out, p.x);
+    write_fraction(out, p.y);
+}
+
+template <typename INPUT>
+bool read_point(INPUT &in, Point &p){
+    return read_fraction(in, p.x) && read_fraction(in, p.y);
+}
+
+template <typename OUTPUT>
+void write_segment_ids(OUTPUT &out, const SegmentIds &ids){
+    write_varint(out, ids.size());
+    for (SegmentId id : ids) write_varint(out, id);
+}
+
+template <typename INPUT>
+bool read_segment_ids(INPUT &in, SegmentIds &ids, size_t num_segments){
+    uint64_t n;
+    if (!read_varint(in, n) || n > num_segments) return false;
+
+    ids.resize(n);
+    for (SegmentId &id : ids){
+        uint64_t value;
+        if (!read_varint(in, value) || value >= num_segments) return false;
+        id = value;
+    }
+    return true;
+}
+
+const char SWEEPLINE_SNAPSHOT_MAGIC[4] = {'S', 'W', 'P', '3'};
+
+// Resumable sweep over SEGMENTS, which must provide size(), a(id) and b(id),
+// see SegmentArrays. The segments must outlive the Sweepline.
+//
+// Each call of next() processes event points until one with at least two
+// segments is found, so intersections can be consumed one at a time:
+//
+//     Sweepline<SegmentArrays<int64_t>> sweep(segments);
+//     while (sweep.next()){
+//         // Use sweep.event_point and sweep.intersecting_segments
+//     }
+//
+// Between calls of step() or next(), the state can be saved with save() and
+// restored later with load() on a Sweepline constructed from the same segments.
+//
+// With linear_event_queue, only intersections of currently neighboring
+// SweepSegments are kept in the event_queue, as suggested by Brown. When two
+// SweepSegments stop being neighbors, their intersection events are removed
+// again unless something else refers to them, so the event_queue has O(n)
+// entries instead of O(n + k). Intersections are recomputed when the
+// SweepSegments become neighbors again, so tested neighbors are not skipped.
+template <typename SEGMENTS>
+struct Sweepline {
+    OrientedSegments<SEGMENTS> segments;
+    bool linear_event_queue;
+
+    EventQueue event_queue;
     Points tmp_intersections;
 
-    // Find slope larger than all other slopes to use as sentinel value
-    Fraction max_slope(0);
-    for (Segment &seg : segments){
-        if (seg.b < seg.a){
-            std::swap(seg.a, seg.b);
+    Point event_point;
+    SweepKey get_sweep_key;
+    SegmentComparator segment_comparator;
+    std::set<SweepSegment, SegmentComparator> sweepline;
+
+    // Ids of all segments going through the most recent event_point
+    SegmentIds intersecting_segments;
+    std::vector<SweepSegment> merged_intersecting_segments;
+
+    SweepStats stats;
+
+    Sweepline(const SEGMENTS &input_segments, bool linear_event_queue = false):
+        segments(input_segments),
+        linear_event_queue(linear_event_queue),
+        event_point{0, 0},
+        get_sweep_key(event_point, 0),
+        segment_comparator(get_sweep_key),
+        sweepline(segment_comparator)
+    {
+        assert(input_segments.size() <= UINT32_MAX);
+
+        // Find slope larger than all other slopes to use as sentinel value
+        Fraction max_slope(0);
+        for (SegmentId id = 0; id < segments.size(); id++){
+            Segment seg = segments.segment(id);
+
+            if (!seg.is_vertical()){
+                Fraction abs_slope = abs(seg.slope());
+                if (abs_slope > max_slope) max_slope = abs_slope;
+            }
+
+            Event &event = event_queue[seg.a];
+            event.start_segments.push_back(id);
+            event.num_references++;
         }
+        get_sweep_key.max_slope = max_slope + 1;
+    }
 
-        if (!seg.is_vertical()){
-            Fraction abs_slope = abs(seg.slope());
-            if (abs_slope > max_slope) max_slope = abs_slope;
+    // SweepKey and SegmentComparator refer to members of this object
+    Sweepline(const Sweepline&) = delete;
+    Sweepline& operator = (const Sweepline&) = delete;
+
+    // Write the remaining event_queue and the current sweepline to out.
+    // The input segments are not included.
+    void save(std::ostream &out) const {
+        out.write(SWEEPLINE_SNAPSHOT_MAGIC, sizeof(SWEEPLINE_SNAPSHOT_MAGIC));
+        write_varint(out, segments.size());
+        write_varint(out, linear_event_queue);
+        write_fraction(out, get_sweep_key.max_slope);
+        write_point(out, event_point);
+        write_varint(out, stats.max_sweepline_size);
+
+        write_varint(out, event_queue.size());
+        for (const auto &event : event_queue){
+            write_point(out, event.first);
+            write_segment_ids(out, event.second.start_segments);
         }
 
-        event_queue[seg.a].start_segments.push_back(seg);
+        write_varint(out, sweepline.size());
+        for (const SweepSegment &seg : sweepline){
+            write_point(out, seg.a);
+            write_point(out, seg.b);
+            write_varint(out, seg.version);
+            write_segment_ids(out, seg.segment_ids);
+
+            write_varint(out, seg.upper_events.size());
+            for (EventQueue::iterator it : seg.upper_events){
+                write_point(out, it->first);
+            }
+        }
     }
-    max_slope += 1;
 
-    Point event_point{0, 0};
-    SweepKey get_sweep_key(event_point, max_slope);
-    SegmentComparator segment_comparator(get_sweep_key);
-    std::set<SweepSegment, SegmentComparator> sweepline(segment_comparator);
+    // Replace the state of this Sweepline with a snapshot written by save(),
+    // including linear_event_queue. Returns false if the snapshot is invalid or was made for a different
+    // number of segments, in which case the state is unspecified.
+    bool load(std::istream &in){
+        char magic[sizeof(SWEEPLINE_SNAPSHOT_MAGIC)];
+        if (!in.read(magic, sizeof(magic))) return false;
+        if (!std::equal(magic, magic + sizeof(magic), SWEEPLINE_SNAPSHOT_MAGIC)) return false;
+
+        uint64_t num_segments, n, version, n_upper_events;
+        if (!read_varint(in, num_segments) || num_segments != segments.size()) return false;
+        if (!read_varint(in, n)) return false;
+        linear_event_queue = n;
+        if (!read_fraction(in, get_sweep_key.max_slope)) return false;
+        if (!read_point(in, event_point)) return false;
+        if (!read_varint(in, n)) return false;
+        stats.max_sweepline_size = n;
+
+        sweepline.clear();
+        event_queue.clear();
+        if (!read_varint(in, n)) return false;
+        for (uint64_t i = 0; i < n; i++){
+            Point p;
+            if (!read_point(in, p)) return false;
+
+            Event &event = event_queue[p];
+            if (!read_segment_ids(in, event.start_segments, num_segments)) return false;
+            event.num_references = event.start_segments.size();
+        }
 
-    std::vector<const Segment*> intersecting_segments;
+        std::vector<SweepSegment> sweep_segments;
+        if (!read_varint(in, n)) return false;
+        for (uint64_t i = 0; i < n; i++){
+            sweep_segments.emplace_back(event_point, event_point);
+            SweepSegment &seg = sweep_segments.back();
+            if (!read_point(in, seg.a) || !read_point(in, seg.b)) return false;
+            if (!read_varint(in, version) || version >= num_segments) return false;
+            seg.version = version;
+            if (!read_segment_ids(in, seg.segment_ids, num_segments)) return false;
+
+            // Restore references of end points and intersections to events
+            for (SegmentId id : seg.segment_ids){
+                Point end = segments.end(id);
+                if (end > event_point){
+                    EventQueue::iterator it = event_queue.find(end);
+                    if (it == event_queue.end()) return false;
+                    it->second.num_references++;
+                }
+            }
+
+            if (!read_varint(in, n_upper_events)) return false;
+            for (uint64_t j = 0; j < n_upper_events; j++){
+                Point p;
+                if (!read_point(in, p)) return false;
+
+                EventQueue::iterator it = event_queue.find(p);
+                if (it == event_queue.end()) return false;
+                it->second.num_references++;
+                seg.upper_events.push_back(it);
+            }
+        }
+
+        // The sweepline was saved in order. Segments through the event_point
+        // are ordered as after the event_point, so insert with after_event_point
+        // set, which keeps the order of all other segments.
+        get_sweep_key.after_event_point = true;
+        for (SweepSegment &seg : sweep_segments){
+            sweepline.insert(sweepline.end(), std::move(seg));
+        }
+        get_sweep_key.after_event_point = false;
+
+        return sweepline.size() == n;
+    }
+
+    // Remove intersection events of seg with its upper neighbor if nothing else refers to them
+    void release_upper_events(const SweepSegment &seg){
+        std::vector<EventQueue::iterator> &upper_events = seg.upper_events;
+
+        for (EventQueue::iterator it : upper_events){
+            // The current event is removed at the end of step()
+            if (--it->second.num_references == 0 && it != event_queue.begin()){
+                event_queue.erase(it);
+            }
+        }
+
+        upper_events.clear();
+    }
+
+    // Add intersections of neighbors seg0 (below) and seg1 (above) after the event_point to the event_queue.
+    //
+    // The same pair is often tested again, e.g. when the SweepSegments are
+    // re-inserted after an event_point. Each SweepSegment remembers the
+    // versions of the neighbors it was tested with last, which only costs
+    // O(1) memory per SweepSegment.
+    void add_intersections(const SweepSegment &seg0, const SweepSegment &seg1){
+        if (linear_event_queue){
+            release_upper_events(seg0);
+        }else{
+            // Neighbors swap their order at intersections, so check both sides
+            if (seg0.tested_upper == seg1.version || seg0.tested_lower == seg1.version ||
+                seg1.tested_lower == seg0.version || seg1.tested_upper == seg0.version){
+                stats.num_cached_intersection_tests++;
+                return;
+            }
+
+            seg0.tested_upper = seg1.version;
+            seg1.tested_lower = seg0.version;
+        }
+
+        stats.num_intersection_tests++;
+
+        tmp_intersections.clear();
+        find_intersections_two_segments(seg0.a, seg0.b, seg1.a, seg1.b, tmp_intersections);
+
+        for (const Point &intersection : tmp_intersections){
+            if (intersection > event_point){
+                EventQueue::iterator it = event_queue.emplace(intersection, Event()).first;
+
+                if (linear_event_queue){
+                    it->second.num_references++;
+                    seg0.upper_events.push_back(it);
+                }
+            }
+        }
+    }
+
+    // Advance to the next event point with at least two segments.
+    // Returns false once all event points have been processed.
+    bool next(){
+        while (step()){
+            if (intersecting_segments.size() > 1) return true;
+        }
+        return false;
+    }
+
+    // Process a single event point. Returns false if there was none left.
+    bool step(){
+        intersecting_segments.clear();
+
+        if (event_queue.empty()) return false;
 
-    size_t max_sweepline_size = 0;
-    while (!event_queue.empty()){
         // Get new event point
         const auto &it_event = event_queue.begin();
         event_point = it_event->first;
 
         // Insert new segments starting at event point
-        SegmentList &new_segments = it_event->second.start_segments;
-
-        while (!new_segments.empty()){
-            Segment &actual_seg = *new_segments.begin();
-            new_segments.pop_front();
+        for (SegmentId id : it_event->second.start_segments){
+            Segment actual_seg = segments.segment(id);
 
+            // End points only need an event, the segment is removed from
+            // its SweepSegment when the SweepSegment is re-inserted there.
             if (actual_seg.b > event_point){
-                event_queue[actual_seg.b].end_segments.push_back(actual_seg);
+                event_queue[actual_seg.b].num_references++;
             }
 
             std::set<SweepSegment>::iterator it;
@@ -353,31 +839,29 @@ void find_intersections_sweepline(Segments &segments, INTERSECTION_CALLBACK &cal
             // Merge with parallel segment if exists
             std::set<SweepSegment>::iterator it_lower_bound = sweepline.lower_bound(SweepSegment(actual_seg.a, actual_seg.b));
             if (it_lower_bound != sweepline.end() && get_sweep_key(*it_lower_bound) == get_sweep_key(actual_seg)){
-                // TODO don't remove const somehow
-                SweepSegment &seg2 = *(SweepSegment*)&(*it_lower_bound);
-
-                seg2.add(actual_seg);
-
                 it = it_lower_bound;
             }else{
                 it = sweepline.emplace(actual_seg.a, actual_seg.b).first;
-
-                // TODO don't remove const somehow
-                SweepSegment &seg2 = *(SweepSegment*)&(*it);
-                seg2.add(actual_seg);
             }
 
-            // Check segment below and above newly inserted segment for intersections
+            // TODO don't remove const somehow
+            SweepSegment &seg2 = *(SweepSegment*)&(*it);
+            seg2.add(id, actual_seg);
+
+            // Check segment below and above newly inserted segment for intersections.
+            // With linear_event_queue, this also removes intersections of the
+            // previous neighbors, which are now separated by the new segment.
             if (it != sweepline.begin()){
-                add_intersections_as_event_points(event_queue, tmp_intersections, event_point, *std::prev(it), *it);
+                add_intersections(*std::prev(it), *it);
             }
 
             if (std::next(it) != sweepline.end()){
-                add_intersections_as_event_points(event_queue, tmp_intersections, event_point, *it, *std::next(it));
+                add_intersections(*it, *std::next(it));
             }
         }
 
-        max_sweepline_size = std::max(max_sweepline_size, sweepline.size());
+        stats.max_sweepline_size = std::max(stats.max_sweepline_size, sweepline.size());
+        stats.max_event_queue_size = std::max(stats.max_event_queue_size, event_queue.size());
 
         // Find segments going through event_point
         Segment lower_segment{event_point, event_point + Point{0, 1}};
@@ -390,27 +874,32 @@ void find_intersections_sweepline(Segments &segments, INTERSECTION_CALLBACK &cal
         std::set<SweepSegment>::iterator end = begin;
         while (end != sweepline.end() && !segment_comparator(upper_segment, *end)) ++end;
 
-        //t.stop("find bounds");
-
         std::set<SweepSegment>::iterator prev = begin != sweepline.begin() ? std::prev(begin) : sweepline.end();
 
-        std::vector<SweepSegment> merged_intersecting_segments(begin, end);
+        // The SweepSegments through event_point and their neighbors get new neighbors
+        if (linear_event_queue && prev != sweepline.end()){
+            release_upper_events(*prev);
+        }
 
-        intersecting_segments.clear();
-        size_t num_intersecting_segments = 0;
-        for (const SweepSegment &merged_segment : merged_intersecting_segments){
-            //num_intersecting_segments += merged_segment.indices.size();
-            for (const Segment &segment : merged_segment.parallel_segments){
-                // Only used for counting
-                (void)segment;
-                num_intersecting_segments++;
+        // Move segment ids out of the sweepline instead of copying them
+        merged_intersecting_segments.clear();
+        for (std::set<SweepSegment>::iterator it = begin; it != end; ++it){
+            // TODO don't remove const somehow
+            SweepSegment &merged_segment = *(SweepSegment*)&(*it);
 
-                intersecting_segments.push_back(&segment);
+            if (linear_event_queue){
+                release_upper_events(merged_segment);
             }
-        }
 
-        if (intersecting_segments.size() > 1){
-            callback(event_point, intersecting_segments);
+            merged_intersecting_segments.emplace_back(merged_segment.a, merged_segment.b);
+            merged_intersecting_segments.back().segment_ids.swap(merged_segment.segment_ids);
+            merged_intersecting_segments.back().version = merged_segment.version;
+            merged_intersecting_segments.back().tested_lower = merged_segment.tested_lower;
+            merged_intersecting_segments.back().tested_upper = merged_segment.tested_upper;
+
+            for (SegmentId id : merged_intersecting_segments.back().segment_ids){
+                intersecting_segments.push_back(id);
+            }
         }
 
         // TODO no re-add if only single segment and no ends to delete
@@ -419,14 +908,20 @@ void find_intersections_sweepline(Segments &segments, INTERSECTION_CALLBACK &cal
         // Indicate that SweepKey should be reversed for event_point segments
         get_sweep_key.after_event_point = true;
 
-        for (Segment &seg : it_event->second.end_segments){
-            SegmentList::erase_value(seg);
-        }
-
         for (SweepSegment &seg : merged_intersecting_segments){
-            if (seg.b > event_point && !seg.parallel_segments.empty()){
-                // TODO use insert hint
-                sweepline.insert(seg);
+            if (seg.b > event_point){
+                // Remove segments ending at event_point
+                SegmentIds &ids = seg.segment_ids;
+                size_t n = 0;
+                for (SegmentId id : ids){
+                    if (segments.end(id) > event_point) ids[n++] = id;
+                }
+                ids.resize(n);
+
+                if (!ids.empty()){
+                    // TODO use insert hint
+                    sweepline.insert(std::move(seg));
+                }
             }
         }
 
@@ -435,29 +930,1249 @@ void find_intersections_sweepline(Segments &segments, INTERSECTION_CALLBACK &cal
 
         // Check for new intersections above and below intersecting segments
         if (prev != sweepline.end() && std::next(prev) != sweepline.end()){
-            add_intersections_as_event_points(event_queue, tmp_intersections, event_point, *prev, *std::next(prev));
+            add_intersections(*prev, *std::next(prev));
         }
 
-        if (end != sweepline.end() && end != sweepline.begin()){
-            add_intersections_as_event_points(event_queue, tmp_intersections, event_point, *std::prev(end), *end);
+        // Same pair as above if no SweepSegment has been re-inserted
+        if (end != sweepline.end() && end != sweepline.begin() && std::prev(end) != prev){
+            add_intersections(*std::prev(end), *end);
         }
 
         event_queue.erase(it_event);
+
+        return true;
     }
-}
+};
 
-struct IntersectionCallbackDiscardSegments {
-    std::vector<Point> intersections;
+// Set of integers in [0, n) stored as a hierarchy of bitsets where each bit
+// of a higher level indicates a non-empty word of the level below.
+// Finding the next element takes O(log_64 n).
+struct RankSet {
+    std::vector<std::vector<uint64_t>> levels;
+
+    RankSet(size_t n){
+        do {
+            n = (n + 63) / 64;
+            levels.emplace_back(n, 0);
+        } while (n > 1);
+    }
 
-    void operator () (
-        const Point &intersection,
-        const std::vector<const Segment*>&
-    ){
-        intersections.push_back(intersection);
+    void insert(size_t i){
+        for (std::vector<uint64_t> &level : levels){
+            level[i / 64] |= uint64_t(1) << (i % 64);
+            i /= 64;
+        }
+    }
+
+    void erase(size_t i){
+        for (std::vector<uint64_t> &level : levels){
+            level[i / 64] &= ~(uint64_t(1) << (i % 64));
+            if (level[i / 64]) break;
+            i /= 64;
+        }
+    }
+
+    // Smallest element >= i or SIZE_MAX if there is none
+    size_t next(size_t i) const {
+        size_t level = 0;
+
+        // Go up until a word contains an element >= i
+        while (true){
+            if (level == levels.size()) return SIZE_MAX;
+
+            size_t word = i / 64;
+            if (word >= levels[level].size()) return SIZE_MAX;
+
+            uint64_t bits = levels[level][word] & (~uint64_t(0) << (i % 64));
+            if (bits){
+                i = word * 64 + __builtin_ctzll(bits);
+                break;
+            }
+
+            i = word + 1;
+            level++;
+        }
+
+        // Go down to the smallest element
+        while (level > 0){
+            level--;
+            i = i * 64 + __builtin_ctzll(levels[level][i]);
+        }
+
+        return i;
     }
 };
 
-std::vector<Point> find_intersections_sweepline(Segments &segments){
+// Maps coordinates to their rank among all distinct coordinates
+struct CoordinateRanks {
+    std::vector<Fraction> values;
+
+    void add(const Fraction &value){
+        values.push_back(value);
+    }
+
+    void finish(){
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+    }
+
+    uint32_t operator () (const Fraction &value) const {
+        return std::lower_bound(values.begin(), values.end(), value) - values.begin();
+    }
+};
+
+// Compressed sparse rows of segment ids, e.g. segments grouped by column
+struct SegmentBuckets {
+    std::vector<uint32_t> offsets;
+    SegmentIds ids;
+
+    SegmentBuckets(size_t num_buckets): offsets(num_buckets + 2, 0){}
+
+    // First count all ids of each bucket, then call start() and add all ids again
+    void count(uint32_t bucket){
+        offsets[bucket + 2]++;
+    }
+
+    void start(){
+        for (size_t i = 2; i < offsets.size(); i++) offsets[i] += offsets[i - 1];
+        ids.resize(offsets.back());
+    }
+
+    void add(uint32_t bucket, SegmentId id){
+        ids[offsets[bucket + 1]++] = id;
+    }
+
+    const SegmentId* begin(uint32_t bucket) const {
+        return ids.data() + offsets[bucket];
+    }
+
+    const SegmentId* end(uint32_t bucket) const {
+        return ids.data() + offsets[bucket + 1];
+    }
+};
+
+template <typename SEGMENTS>
+bool all_segments_axis_parallel(const SEGMENTS &segments){
+    for (SegmentId id = 0; id < segments.size(); id++){
+        Point a = segments.a(id);
+        Point b = segments.b(id);
+
+        if (a.x != b.x && a.y != b.y) return false;
+    }
+    return true;
+}
+
+// Same result as the general sweep, but only for horizontal and vertical
+// segments (and points). Coordinates are replaced by their ranks and the
+// columns are swept from left to right. Horizontal segments are inserted
+// into a RankSet of occupied rows at their first column and removed after
+// their last column. Vertical segments query the occupied rows in their
+// y-range. Runs in O(n log n + k) with only integer operations after sorting.
+template <typename SEGMENTS, typename INTERSECTION_CALLBACK>
+void find_intersections_orthogonal(const SEGMENTS &input_segments, INTERSECTION_CALLBACK &callback){
+    assert(input_segments.size() <= UINT32_MAX);
+
+    OrientedSegments<SEGMENTS> segments(input_segments);
+    SegmentId n = segments.size();
+
+    CoordinateRanks xs, ys;
+    for (SegmentId id = 0; id < n; id++){
+        Segment seg = segments.segment(id);
+        assert(seg.a.x == seg.b.x || seg.a.y == seg.b.y);
+
+        xs.add(seg.a.x);
+        xs.add(seg.b.x);
+        ys.add(seg.a.y);
+        ys.add(seg.b.y);
+    }
+    xs.finish();
+    ys.finish();
+
+    std::vector<uint32_t> x0(n), y0(n), x1(n), y1(n);
+    for (SegmentId id = 0; id < n; id++){
+        Segment seg = segments.segment(id);
+
+        x0[id] = xs(seg.a.x);
+        y0[id] = ys(seg.a.y);
+        x1[id] = xs(seg.b.x);
+        y1[id] = ys(seg.b.y);
+    }
+
+    uint32_t num_columns = xs.values.size();
+    uint32_t num_rows = ys.values.size();
+
+    // Horizontal segments by first and last column,
+    // vertical segments (including points) by column.
+    SegmentBuckets starts(num_columns), ends(num_columns), verticals(num_columns);
+    for (int pass = 0; pass < 2; pass++){
+        for (SegmentId id = 0; id < n; id++){
+            if (x0[id] == x1[id]){
+                if (pass == 0) verticals.count(x0[id]); else verticals.add(x0[id], id);
+            }else{
+                if (pass == 0) starts.count(x0[id]); else starts.add(x0[id], id);
+                if (pass == 0) ends.count(x1[id]); else ends.add(x1[id], id);
+            }
+        }
+
+        if (pass == 0){
+            starts.start();
+            ends.start();
+            verticals.start();
+        }
+    }
+
+    // Horizontal segments in each row which cover the current column.
+    // position[id] is the index of segment id in its row to erase in O(1).
+    std::vector<SegmentIds> row_segments(num_rows);
+    std::vector<uint32_t> position(n);
+    RankSet occupied_rows(num_rows);
+
+    SegmentIds column_verticals;
+    SegmentIds active_verticals;
+    std::vector<uint32_t> rows;
+    SegmentIds intersecting_segments;
+
+    for (uint32_t column = 0; column < num_columns; column++){
+        for (const SegmentId *it = starts.begin(column); it != starts.end(column); ++it){
+            SegmentIds &row = row_segments[y0[*it]];
+            if (row.empty()) occupied_rows.insert(y0[*it]);
+            position[*it] = row.size();
+            row.push_back(*it);
+        }
+
+        column_verticals.assign(verticals.begin(column), verticals.end(column));
+        std::sort(column_verticals.begin(), column_verticals.end(), [&](SegmentId i, SegmentId j){
+            return y0[i] < y0[j];
+        });
+
+        // Rows where an intersection might be in this column
+        rows.clear();
+        for (const SegmentId *it = starts.begin(column); it != starts.end(column); ++it){
+            rows.push_back(y0[*it]);
+        }
+        for (const SegmentId *it = ends.begin(column); it != ends.end(column); ++it){
+            rows.push_back(y0[*it]);
+        }
+        for (SegmentId id : column_verticals){
+            rows.push_back(y0[id]);
+            rows.push_back(y1[id]);
+
+            for (size_t row = occupied_rows.next(y0[id]); row <= y1[id]; row = occupied_rows.next(row + 1)){
+                rows.push_back(row);
+            }
+        }
+        std::sort(rows.begin(), rows.end());
+        rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+        // Walk up the column, keeping track of vertical segments covering the current row
+        active_verticals.clear();
+        size_t next_vertical = 0;
+        for (uint32_t row : rows){
+            while (next_vertical < column_verticals.size() && y0[column_verticals[next_vertical]] <= row){
+                active_verticals.push_back(column_verticals[next_vertical++]);
+            }
+
+            size_t num_active = 0;
+            for (SegmentId id : active_verticals){
+                if (y1[id] >= row) active_verticals[num_active++] = id;
+            }
+            active_verticals.resize(num_active);
+
+            intersecting_segments.assign(row_segments[row].begin(), row_segments[row].end());
+            intersecting_segments.insert(intersecting_segments.end(), active_verticals.begin(), active_verticals.end());
+
+            if (intersecting_segments.size() > 1){
+                callback(Point(xs.values[column], ys.values[row]), intersecting_segments);
+            }
+        }
+
+        for (const SegmentId *it = ends.begin(column); it != ends.end(column); ++it){
+            SegmentIds &row = row_segments[y0[*it]];
+
+            // Move last segment of row into the gap
+            row[position[*it]] = row.back();
+            position[row.back()] = position[*it];
+            row.pop_back();
+
+            if (row.empty()) occupied_rows.erase(y0[*it]);
+        }
+    }
+}
+
+// Segment tree over ranks [0, n). Each interval is stored in the O(log n)
+// nodes which cover it, so the intervals containing a rank are found on the
+// path from its leaf to the root. Removed intervals are skipped and dropped
+// lazily when a node is visited.
+struct IntervalStabbingTree {
+    size_t num_leaves = 1;
+    std::vector<SegmentIds> nodes;
+
+    IntervalStabbingTree(size_t n){
+        while (num_leaves < n) num_leaves *= 2;
+        nodes.resize(2 * num_leaves);
+    }
+
+    // Insert id with interval [lo, hi]
+    void insert(uint32_t lo, uint32_t hi, SegmentId id){
+        for (size_t l = lo + num_leaves, r = hi + num_leaves + 1; l < r; l /= 2, r /= 2){
+            if (l & 1) nodes[l++].push_back(id);
+            if (r & 1) nodes[--r].push_back(id);
+        }
+    }
+
+    // Append ids of active intervals containing i to result
+    void stab(uint32_t i, const std::vector<bool> &active, SegmentIds &result){
+        for (size_t node = i + num_leaves; node > 0; node /= 2){
+            SegmentIds &ids = nodes[node];
+
+            size_t n = 0;
+            for (SegmentId id : ids){
+                if (active[id]){
+                    ids[n++] = id;
+                    result.push_back(id);
+                }
+            }
+            ids.resize(n);
+        }
+    }
+};
+
+// Candidates of find_segments_within_distance whose bounding boxes grown by
+// distance overlap, see find_segments_within_distance. Returns false as soon
+// as there are more than max_candidates, which happens for many long
+// parallel segments, for example.
+//
+// Sweeps over x. A segment becomes active at its smallest x and is removed
+// after its largest x plus distance. When a segment becomes active, the
+// active segments whose y-range overlaps its y-range grown by distance are
+// found in rank space: those containing the lower end in an
+// IntervalStabbingTree, and those starting inside the range in a RankSet.
+template <typename SEGMENTS>
+bool find_clearance_candidates_by_boxes(const OrientedSegments<SEGMENTS> &segments, const Fraction &distance, size_t max_candidates, std::vector<uint64_t> &pairs){
+    SegmentId n = segments.size();
+
+    // Events at smallest x to insert and at largest x + distance to remove.
+    // Insertion comes first if both are at the same x.
+    std::vector<std::pair<std::pair<Fraction, bool>, SegmentId>> events;
+    CoordinateRanks ys;
+    for (SegmentId id = 0; id < n; id++){
+        Segment seg = segments.segment(id);
+        Fraction y_min = std::min(seg.a.y, seg.b.y);
+        Fraction y_max = std::max(seg.a.y, seg.b.y);
+
+        events.push_back(std::make_pair(std::make_pair(seg.a.x, false), id));
+        events.push_back(std::make_pair(std::make_pair(seg.b.x + distance, true), id));
+
+        ys.add(y_min);
+        ys.add(y_max);
+        ys.add(y_min - distance);
+        ys.add(y_max + distance);
+    }
+    std::sort(events.begin(), events.end());
+    ys.finish();
+
+    std::vector<uint32_t> y0(n), y1(n);
+    for (SegmentId id = 0; id < n; id++){
+        Segment seg = segments.segment(id);
+
+        y0[id] = ys(std::min(seg.a.y, seg.b.y));
+        y1[id] = ys(std::max(seg.a.y, seg.b.y));
+    }
+
+    uint32_t num_rows = ys.values.size();
+
+    // Active segments by lowest row, position[id] is the index in its row to erase in O(1)
+    std::vector<SegmentIds> row_segments(num_rows);
+    std::vector<uint32_t> position(n);
+    RankSet occupied_rows(num_rows);
+    IntervalStabbingTree stabbing_tree(num_rows);
+    std::vector<bool> active(n);
+
+    SegmentIds candidates;
+    for (const auto &event : events){
+        SegmentId id = event.second;
+        SegmentIds &row = row_segments[y0[id]];
+
+        if (event.first.second){
+            active[id] = false;
+
+            // Move last segment of row into the gap
+            row[position[id]] = row.back();
+            position[row.back()] = position[id];
+            row.pop_back();
+
+            if (row.empty()) occupied_rows.erase(y0[id]);
+
+            continue;
+        }
+
+        Segment seg = segments.segment(id);
+        uint32_t lo = ys(std::min(seg.a.y, seg.b.y) - distance);
+        uint32_t hi = ys(std::max(seg.a.y, seg.b.y) + distance);
+
+        candidates.clear();
+        stabbing_tree.stab(lo, active, candidates);
+        for (size_t r = occupied_rows.next(lo + 1); r <= hi; r = occupied_rows.next(r + 1)){
+            candidates.insert(candidates.end(), row_segments[r].begin(), row_segments[r].end());
+        }
+
+        for (SegmentId other : candidates){
+            pairs.push_back((uint64_t(std::min(id, other)) << 32) | std::max(id, other));
+        }
+        if (pairs.size() > max_candidates) return false;
+
+        active[id] = true;
+        if (row.empty()) occupied_rows.insert(y0[id]);
+        position[id] = row.size();
+        row.push_back(id);
+        stabbing_tree.insert(y0[id], y1[id], id);
+    }
+
+    return true;
+}
+
+// Result of VerticalDecomposition::locate
+struct PointLocation {
+    // First segment hit by a ray going down from the query point, including
+    // segments through the point itself, or NO_SEGMENT
+    SegmentId below = NO_SEGMENT;
+    // First segment hit by a ray going up which does not go through the point, or NO_SEGMENT
+    SegmentId above = NO_SEGMENT;
+    // Whether below goes through the query point
+    bool on_segment = false;
+};
+
+// Point location in the vertical decomposition of segments and their
+// intersections. The x-coordinates of all event points of a Sweepline split
+// the plane into slabs in which the non-vertical segments do not cross, so
+// each slab is a stack of trapezoids ordered from bottom to top.
+//
+// Instead of storing every slab, consecutive slabs share a persistent treap
+// (Sarnak and Tarjan): only the segments through event points at the slab
+// boundary are erased and re-inserted, copying O(log n) nodes each, so the
+// structure has O((n + k) log n) nodes. A query finds the slab by binary
+// search over x and the trapezoid by descending the treap of the slab with
+// exact orientation tests, both in O(log n).
+//
+// Queries only read the structure, so they can run concurrently.
+template <typename SEGMENTS>
+struct VerticalDecomposition {
+    struct Node {
+        SegmentId id;
+        // Index of child nodes, 0 is the empty tree
+        uint32_t left, right;
+    };
+
+    OrientedSegments<SEGMENTS> segments;
+    std::vector<Fraction> slopes;
+
+    // Distinct x-coordinates of event points. roots[i] is the tree of the
+    // segments crossing the slab between xs[i] and xs[i + 1].
+    std::vector<Fraction> xs;
+    std::vector<uint32_t> roots;
+    std::vector<Node> nodes;
+
+    // Nodes from this index on were created for the current slab and can be changed in place
+    uint32_t first_mutable_node = 0;
+
+    // Vertical segments ordered by their lower end. highest_vertical[i] is the
+    // segment reaching highest among the vertical segments with the same x up to i.
+    SegmentIds verticals;
+    SegmentIds highest_vertical;
+
+    VerticalDecomposition(const SEGMENTS &input_segments):
+        segments(input_segments),
+        slopes(input_segments.size()),
+        nodes(1, Node{0, 0, 0})
+    {
+        assert(input_segments.size() <= UINT32_MAX);
+
+        SegmentId n = segments.size();
+        std::vector<bool> vertical(n);
+        for (SegmentId id = 0; id < n; id++){
+            Segment seg = segments.segment(id);
+
+            if (seg.is_vertical()){
+                vertical[id] = true;
+                verticals.push_back(id);
+            }else{
+                slopes[id] = seg.slope();
+            }
+        }
+
+        std::sort(verticals.begin(), verticals.end(), [this](SegmentId i, SegmentId j){
+            return segments.start(i) < segments.start(j);
+        });
+
+        for (size_t i = 0; i < verticals.size(); i++){
+            SegmentId id = verticals[i];
+
+            if (i > 0 && segments.start(id).x == segments.start(verticals[i - 1]).x){
+                SegmentId highest = highest_vertical.back();
+                highest_vertical.push_back(segments.end(id).y > segments.end(highest).y ? id : highest);
+            }else{
+                highest_vertical.push_back(id);
+            }
+        }
+
+        // Collect segments through event points with the same x
+        Sweepline<SEGMENTS> sweep(input_segments);
+        SegmentIds erased, inserted;
+        uint32_t root = 0;
+        Fraction x;
+
+        for (bool more = sweep.step(); ; more = sweep.step()){
+            if (!xs.empty() && (!more || sweep.event_point.x != x)){
+                first_mutable_node = nodes.size();
+
+                for (SegmentId id : erased) root = erase(root, id, x);
+                for (SegmentId id : inserted) root = insert(root, id, x);
+
+                roots.back() = root;
+                erased.clear();
+                inserted.clear();
+            }
+
+            if (!more) break;
+
+            if (xs.empty() || sweep.event_point.x != x){
+                x = sweep.event_point.x;
+                xs.push_back(x);
+                roots.push_back(root);
+            }
+
+            for (SegmentId id : sweep.intersecting_segments){
+                if (vertical[id]) continue;
+
+                if (segments.start(id).x < x) erased.push_back(id);
+                if (segments.end(id).x > x) inserted.push_back(id);
+            }
+        }
+
+        assert(nodes.size() <= UINT32_MAX);
+    }
+
+    VerticalDecomposition(const VerticalDecomposition&) = delete;
+    VerticalDecomposition& operator = (const VerticalDecomposition&) = delete;
+
+    static uint32_t priority(SegmentId id){
+        uint64_t h = (id + uint64_t(1)) * 0x9e3779b97f4a7c15ull;
+        return h >> 32;
+    }
+
+    Fraction y_at(SegmentId id, const Fraction &x) const {
+        Point a = segments.start(id);
+        return a.y + slopes[id] * (x - a.x);
+    }
+
+    // Order of non-vertical segments right after x (direction 1) or right before x (direction -1)
+    bool less(SegmentId i, SegmentId j, const Fraction &x, int direction) const {
+        Fraction yi = y_at(i, x);
+        Fraction yj = y_at(j, x);
+        if (yi != yj) return yi < yj;
+        if (slopes[i] != slopes[j]) return direction > 0 ? slopes[i] < slopes[j] : slopes[j] < slopes[i];
+        return i < j;
+    }
+
+    uint32_t copy_node(uint32_t t){
+        if (t >= first_mutable_node) return t;
+        nodes.push_back(nodes[t]);
+        return nodes.size() - 1;
+    }
+
+    // Split tree t into segments below and above id right after x
+    void split(uint32_t t, SegmentId id, const Fraction &x, uint32_t &lower, uint32_t &upper){
+        if (t == 0){
+            lower = upper = 0;
+            return;
+        }
+
+        t = copy_node(t);
+        uint32_t child;
+        if (less(nodes[t].id, id, x, 1)){
+            split(nodes[t].right, id, x, child, upper);
+            nodes[t].right = child;
+            lower = t;
+        }else{
+            split(nodes[t].left, id, x, lower, child);
+            nodes[t].left = child;
+            upper = t;
+        }
+    }
+
+    uint32_t merge(uint32_t lower, uint32_t upper){
+        if (lower == 0) return upper;
+        if (upper == 0) return lower;
+
+        uint32_t child;
+        if (priority(nodes[lower].id) > priority(nodes[upper].id)){
+            lower = copy_node(lower);
+            child = merge(nodes[lower].right, upper);
+            nodes[lower].right = child;
+            return lower;
+        }else{
+            upper = copy_node(upper);
+            child = merge(lower, nodes[upper].left);
+            nodes[upper].left = child;
+            return upper;
+        }
+    }
+
+    uint32_t insert(uint32_t t, SegmentId id, const Fraction &x){
+        if (t == 0 || priority(id) > priority(nodes[t].id)){
+            uint32_t lower, upper;
+            split(t, id, x, lower, upper);
+            nodes.push_back(Node{id, lower, upper});
+            return nodes.size() - 1;
+        }
+
+        t = copy_node(t);
+        uint32_t child;
+        if (less(id, nodes[t].id, x, 1)){
+            child = insert(nodes[t].left, id, x);
+            nodes[t].left = child;
+        }else{
+            child = insert(nodes[t].right, id, x);
+            nodes[t].right = child;
+        }
+        return t;
+    }
+
+    uint32_t erase(uint32_t t, SegmentId id, const Fraction &x){
+        assert(t != 0);
+
+        if (nodes[t].id == id) return merge(nodes[t].left, nodes[t].right);
+
+        t = copy_node(t);
+        uint32_t child;
+        if (less(id, nodes[t].id, x, -1)){
+            child = erase(nodes[t].left, id, x);
+            nodes[t].left = child;
+        }else{
+            child = erase(nodes[t].right, id, x);
+            nodes[t].right = child;
+        }
+        return t;
+    }
+
+    // Segments directly below (or through) and above p in the tree of a slab
+    void locate_in_slab(uint32_t t, const Point &p, SegmentId &below, SegmentId &above) const {
+        while (t != 0){
+            SegmentId id = nodes[t].id;
+            Point a = segments.start(id);
+
+            if (det(segments.end(id) - a, p - a) >= 0){
+                below = id;
+                t = nodes[t].right;
+            }else{
+                above = id;
+                t = nodes[t].left;
+            }
+        }
+    }
+
+    PointLocation locate(const Point &p) const {
+        PointLocation result;
+
+        size_t slab = std::upper_bound(xs.begin(), xs.end(), p.x) - xs.begin();
+        if (slab == 0) return result;
+        slab--;
+
+        Fraction below_y, above_y;
+
+        // Points on a slab boundary see the segments of both slabs and vertical segments
+        size_t first_slab = (xs[slab] == p.x && slab > 0) ? slab - 1 : slab;
+        for (size_t i = first_slab; i <= slab; i++){
+            SegmentId below = NO_SEGMENT, above = NO_SEGMENT;
+            locate_in_slab(roots[i], p, below, above);
+
+            if (below != NO_SEGMENT){
+                Fraction y = y_at(below, p.x);
+                if (result.below == NO_SEGMENT || y > below_y){
+                    result.below = below;
+                    below_y = y;
+                }
+            }
+
+            if (above != NO_SEGMENT){
+                Fraction y = y_at(above, p.x);
+                if (result.above == NO_SEGMENT || y < above_y){
+                    result.above = above;
+                    above_y = y;
+                }
+            }
+        }
+
+        if (xs[slab] == p.x){
+            size_t lo = std::lower_bound(verticals.begin(), verticals.end(), p.x, [this](SegmentId id, const Fraction &x){
+                return segments.start(id).x < x;
+            }) - verticals.begin();
+            size_t hi = std::upper_bound(verticals.begin() + lo, verticals.end(), p, [this](const Point &p, SegmentId id){
+                return p < segments.start(id);
+            }) - verticals.begin();
+
+            // Vertical segments starting at or below p
+            if (hi > lo){
+                SegmentId highest = highest_vertical[hi - 1];
+                Fraction y = std::min(segments.end(highest).y, p.y);
+                if (result.below == NO_SEGMENT || y > below_y){
+                    result.below = highest;
+                    below_y = y;
+                }
+            }
+
+            // Lowest vertical segment starting above p
+            if (hi < verticals.size() && segments.start(verticals[hi]).x == p.x){
+                Fraction y = segments.start(verticals[hi]).y;
+                if (result.above == NO_SEGMENT || y < above_y){
+                    result.above = verticals[hi];
+                    above_y = y;
+                }
+            }
+        }
+
+        result.on_segment = result.below != NO_SEGMENT && below_y == p.y;
+
+        return result;
+    }
+
+    // Locate all points, split into contiguous ranges over num_threads
+    // threads. By default, all hardware threads are used.
+    void locate(const Points &points, std::vector<PointLocation> &results, unsigned num_threads = 0) const {
+        results.resize(points.size());
+
+        if (num_threads == 0) num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+        // Small batches are not worth starting threads for
+        size_t chunk_size = std::max<size_t>((points.size() + num_threads - 1) / num_threads, 1024);
+
+        auto locate_range = [this, &points, &results](size_t begin, size_t end){
+            for (size_t i = begin; i < end; i++){
+                results[i] = locate(points[i]);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t begin = chunk_size; begin < points.size(); begin += chunk_size){
+            threads.emplace_back(locate_range, begin, std::min(begin + chunk_size, points.size()));
+        }
+
+        locate_range(0, std::min(chunk_size, points.size()));
+
+        for (std::thread &thread : threads) thread.join();
+    }
+};
+
+// The callback receives the intersection point and the ids of all segments
+// going through that point. Inputs consisting only of horizontal and vertical
+// segments are handled by find_intersections_orthogonal unless allow_orthogonal
+// is false, which forces the general Sweepline, e.g. to test it.
+template <typename SEGMENTS, typename INTERSECTION_CALLBACK>
+void find_intersections_sweepline_ids(const SEGMENTS &segments, INTERSECTION_CALLBACK &callback, bool allow_orthogonal = true){
+    if (allow_orthogonal && all_segments_axis_parallel(segments)){
+        find_intersections_orthogonal(segments, callback);
+        return;
+    }
+
+    Sweepline<SEGMENTS> sweep(segments);
+
+    while (sweep.next()){
+        callback(sweep.event_point, sweep.intersecting_segments);
+    }
+}
+
+// Input segments followed by the edges of two squares around each end point
+// with radius distance and distance / 2, see find_segments_within_distance.
+template <typename SEGMENTS>
+struct ClearanceSegments {
+    const OrientedSegments<SEGMENTS> &segments;
+    Fraction distance, half_distance;
+
+    ClearanceSegments(const OrientedSegments<SEGMENTS> &segments, const Fraction &distance):
+        segments(segments), distance(distance), half_distance(distance / 2){}
+
+    size_t size() const {
+        return 17 * segments.size();
+    }
+
+    // Corner i of the square with radius r around p in counterclockwise order
+    static Point corner(const Point &p, const Fraction &r, int i){
+        Fraction dx = (i == 1 || i == 2) ? r : -r;
+        Fraction dy = i >= 2 ? r : -r;
+        return Point(p.x + dx, p.y + dy);
+    }
+
+    Point end_point(SegmentId id, size_t i) const {
+        size_t end_point_index = (id - segments.size()) / 8;
+        SegmentId owner = end_point_index / 2;
+        Point p = end_point_index % 2 ? segments.end(owner) : segments.start(owner);
+
+        size_t edge = (id - segments.size()) % 8;
+        return corner(p, edge < 4 ? distance : half_distance, (edge + i) % 4);
+    }
+
+    Point a(SegmentId id) const {
+        return id < segments.size() ? segments.start(id) : end_point(id, 0);
+    }
+
+    Point b(SegmentId id) const {
+        return id < segments.size() ? segments.end(id) : end_point(id, 1);
+    }
+};
+
+// Collects pairs of input segments from intersections of ClearanceSegments
+struct ClearanceCandidates {
+    SegmentId num_segments;
+    std::vector<uint64_t> pairs;
+    SegmentIds inputs, squares, half_squares;
+
+    ClearanceCandidates(SegmentId num_segments): num_segments(num_segments){}
+
+    void add(SegmentId i, SegmentId j){
+        if (i != j) pairs.push_back((uint64_t(std::min(i, j)) << 32) | std::max(i, j));
+    }
+
+    static void sort_unique(SegmentIds &ids){
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    }
+
+    void operator () (
+        const Point &intersection,
+        const SegmentIds &segment_ids
+    ){
+        (void)intersection;
+
+        inputs.clear();
+        squares.clear();
+        half_squares.clear();
+
+        for (SegmentId id : segment_ids){
+            if (id < num_segments){
+                inputs.push_back(id);
+            }else{
+                size_t edge = id - num_segments;
+                SegmentId owner = edge / 16;
+                (edge % 8 < 4 ? squares : half_squares).push_back(owner);
+            }
+        }
+
+        sort_unique(squares);
+        sort_unique(half_squares);
+
+        for (size_t i = 0; i < inputs.size(); i++){
+            for (size_t j = i + 1; j < inputs.size(); j++) add(inputs[i], inputs[j]);
+            for (SegmentId owner : squares) add(owner, inputs[i]);
+        }
+
+        for (size_t i = 0; i < half_squares.size(); i++){
+            for (size_t j = i + 1; j < half_squares.size(); j++) add(half_squares[i], half_squares[j]);
+        }
+    }
+};
+
+// Candidates of find_segments_within_distance from intersections of a single
+// sweep, see find_segments_within_distance.
+//
+// Two segments are within distance if they intersect or if an end point of one
+// of them is within distance of the other. Such a segment crosses the square
+// with radius distance around the end point, or has an end point inside it,
+// in which case the squares with radius distance / 2 around both end points
+// overlap. Their boundaries then intersect, since the squares have the same size.
+// So all candidates are intersections found by a single sweep over the
+// segments and the edges of both squares around every end point.
+template <typename SEGMENTS>
+void find_clearance_candidates_by_sweep(const OrientedSegments<SEGMENTS> &segments, const Fraction &distance, std::vector<uint64_t> &pairs){
+    assert(segments.size() <= UINT32_MAX / 17);
+
+    ClearanceSegments<SEGMENTS> clearance_segments(segments, distance);
+    ClearanceCandidates candidates(segments.size());
+    candidates.pairs.swap(pairs);
+    find_intersections_sweepline_ids(clearance_segments, candidates);
+    candidates.pairs.swap(pairs);
+}
+
+// Calls callback(i, j, p, q, squared_distance) once for every pair of segments
+// i < j with squared_distance <= distance^2, where p on segment i and q on
+// segment j are the closest points. Pairs are reported in order of i and j.
+//
+// Candidates are first taken from overlapping bounding boxes grown by
+// distance, which is fast for most inputs, but there can be O(n^2) such pairs
+// even if none are within distance, e.g. for long parallel diagonals. If there
+// are more than max_candidates_per_segment on average, the candidates are
+// found by find_clearance_candidates_by_sweep instead, which
+// takes O((n + k) log n), where k counts the reported pairs plus the pairs of
+// end points whose x and y differ by at most 2 * distance. Candidates are
+// tested exactly and kept until the end to report each pair once, so memory
+// is linear in their number.
+template <typename SEGMENTS, typename CLEARANCE_CALLBACK>
+void find_segments_within_distance(const SEGMENTS &input_segments, const Fraction &distance, CLEARANCE_CALLBACK &callback, size_t max_candidates_per_segment = 128){
+    assert(input_segments.size() <= UINT32_MAX);
+
+    if (distance < 0) return;
+
+    OrientedSegments<SEGMENTS> segments(input_segments);
+    Fraction distance2 = distance * distance;
+
+    std::vector<uint64_t> pairs;
+    size_t max_candidates = max_candidates_per_segment * segments.size();
+    if (!find_clearance_candidates_by_boxes(segments, distance, max_candidates, pairs)){
+        pairs.clear();
+        find_clearance_candidates_by_sweep(segments, distance, pairs);
+    }
+
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    Point p, q;
+    for (uint64_t pair : pairs){
+        SegmentId i = pair >> 32;
+        SegmentId j = pair & UINT32_MAX;
+
+        Fraction d2 = squared_distance_two_segments(segments.start(i), segments.end(i), segments.start(j), segments.end(j), p, q);
+
+        if (d2 <= distance2) callback(i, j, p, q, d2);
+    }
+}
+
+// Translates segment ids back to pointers into the user's std::vector<Segment>
+template <typename INTERSECTION_CALLBACK>
+struct IntersectionCallbackSegmentPointers {
+    const Segments &segments;
+    INTERSECTION_CALLBACK &callback;
+    std::vector<const Segment*> intersecting_segments;
+
+    IntersectionCallbackSegmentPointers(const Segments &segments, INTERSECTION_CALLBACK &callback):
+        segments(segments), callback(callback){}
+
+    void operator () (
+        const Point &intersection,
+        const SegmentIds &segment_ids
+    ){
+        intersecting_segments.clear();
+        for (SegmentId id : segment_ids){
+            intersecting_segments.push_back(&segments[id]);
+        }
+
+        callback(intersection, intersecting_segments);
+    }
+};
+
+template <typename INTERSECTION_CALLBACK>
+void find_intersections_sweepline(Segments &segments, INTERSECTION_CALLBACK &callback, bool allow_orthogonal = true){
+    for (Segment &seg : segments){
+        if (seg.b < seg.a){
+            std::swap(seg.a, seg.b);
+        }
+    }
+
+    IntersectionCallbackSegmentPointers<INTERSECTION_CALLBACK> pointer_callback(segments, callback);
+
+    find_intersections_sweepline_ids(SegmentsView(segments), pointer_callback, allow_orthogonal);
+}
+
+template <typename Coordinate, typename INTERSECTION_CALLBACK>
+void find_intersections_sweepline(const SegmentArrays<Coordinate> &segments, INTERSECTION_CALLBACK &callback, bool allow_orthogonal = true){
+    find_intersections_sweepline_ids(segments, callback, allow_orthogonal);
+}
+
+struct IntersectionCallbackDiscardSegments {
+    std::vector<Point> intersections;
+
+    template <typename SEGMENTS>
+    void operator () (
+        const Point &intersection,
+        const SEGMENTS&
+    ){
+        intersections.push_back(intersection);
+    }
+};
+
+uint64_t zigzag_encode(int64_t x){
+    return (uint64_t(x) << 1) ^ uint64_t(x >> 63);
+}
+
+int64_t zigzag_decode(uint64_t x){
+    return int64_t(x >> 1) ^ -int64_t(x & 1);
+}
+
+// Denominator and zigzag numerator as varints if they fit into int64_t,
+// else a zero followed by the full fraction.
+template <typename OUTPUT>
+void write_compact_fraction(OUTPUT &out, const Fraction &x){
+    int64_t num, den;
+    if (get_int64(x, num, den)){
+        write_varint(out, den);
+        write_varint(out, zigzag_encode(num));
+    }else{
+        write_varint(out, 0);
+        write_fraction(out, x);
+    }
+}
+
+template <typename INPUT>
+bool read_compact_fraction(INPUT &in, Fraction &x){
+    uint64_t den, num;
+    if (!read_varint(in, den)) return false;
+    if (den == 0) return read_fraction(in, x);
+    if (!read_varint(in, num) || den > INT64_MAX) return false;
+    x = Fraction(zigzag_decode(num)) / Fraction(int64_t(den));
+    return true;
+}
+
+const char COMPACT_INTERSECTIONS_MAGIC[4] = {'S', 'W', 'I', '1'};
+
+// Size of the file header: magic and number of intersections as 8 bytes little endian
+const size_t COMPACT_INTERSECTIONS_HEADER_SIZE = sizeof(COMPACT_INTERSECTIONS_MAGIC) + 8;
+
+// Callback which stores intersections compactly in event order. Once more
+// than memory_budget bytes are buffered, they are appended to a file at path,
+// or to an anonymous temporary file if no path is given.
+// Use CompactIntersectionReader to read the intersections back.
+//
+// With a path, call finish() after the sweep to write the remaining buffer
+// and the number of intersections to the file header, so the file can be
+// read later with CompactIntersectionReader(path). The destructor calls
+// finish() if it has not been called, but can not report errors.
+//
+// Each intersection is stored as a varint of twice the number of segments
+// plus one if x equals the x of the previous intersection, the x-coordinate
+// unless it is the same, the y-coordinate, the first segment id and the
+// zigzag encoded differences between consecutive segment ids.
+struct CompactIntersectionSink {
+    std::string buffer;
+    size_t memory_budget;
+    std::string path;
+    FILE *file = NULL;
+    size_t num_intersections = 0;
+    Fraction previous_x;
+    bool finished = false;
+
+    CompactIntersectionSink(size_t memory_budget = 64 << 20, const std::string &path = ""):
+        memory_budget(memory_budget), path(path){}
+
+    ~CompactIntersectionSink(){
+        if (!path.empty() && !finished){
+            try {
+                finish();
+            }catch (const std::runtime_error&){
+            }
+        }
+        if (file) fclose(file);
+    }
+
+    CompactIntersectionSink(const CompactIntersectionSink&) = delete;
+    CompactIntersectionSink& operator = (const CompactIntersectionSink&) = delete;
+
+    void put(char c){
+        buffer.push_back(c);
+    }
+
+    void write(const char *data, size_t n){
+        buffer.append(data, n);
+    }
+
+    void operator () (
+        const Point &intersection,
+        const SegmentIds &segment_ids
+    ){
+        assert(!finished);
+
+        bool same_x = num_intersections > 0 && intersection.x == previous_x;
+
+        write_varint(*this, 2 * segment_ids.size() + same_x);
+        if (!same_x){
+            write_compact_fraction(*this, intersection.x);
+            previous_x = intersection.x;
+        }
+        write_compact_fraction(*this, intersection.y);
+
+        for (size_t i = 0; i < segment_ids.size(); i++){
+            if (i == 0){
+                write_varint(*this, segment_ids[i]);
+            }else{
+                write_varint(*this, zigzag_encode(int64_t(segment_ids[i]) - segment_ids[i - 1]));
+            }
+        }
+
+        num_intersections++;
+
+        if (buffer.size() >= memory_budget) spill();
+    }
+
+    // Append buffer to file. The header is written when the file is created
+    // and updated by finish().
+    void spill(){
+        if (!file){
+            file = path.empty() ? tmpfile() : fopen(path.c_str(), "w+b");
+            if (!file) throw std::runtime_error("Can not open file to spill intersections");
+
+            char header[COMPACT_INTERSECTIONS_HEADER_SIZE] = {0};
+            std::copy(COMPACT_INTERSECTIONS_MAGIC, COMPACT_INTERSECTIONS_MAGIC + sizeof(COMPACT_INTERSECTIONS_MAGIC), header);
+            if (fwrite(header, 1, sizeof(header), file) != sizeof(header)){
+                throw std::runtime_error("Can not write spilled intersections");
+            }
+        }
+
+        fseek(file, 0, SEEK_END);
+        if (fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()){
+            throw std::runtime_error("Can not write spilled intersections");
+        }
+        buffer.clear();
+    }
+
+    // Write the remaining intersections and the header to the file at path.
+    // Without a path, the intersections stay in memory and the temporary file.
+    void finish(){
+        finished = true;
+
+        if (path.empty()) return;
+
+        spill();
+
+        unsigned char count[8];
+        for (int i = 0; i < 8; i++) count[i] = uint64_t(num_intersections) >> (8 * i);
+
+        fseek(file, sizeof(COMPACT_INTERSECTIONS_MAGIC), SEEK_SET);
+        if (fwrite(count, 1, sizeof(count), file) != sizeof(count) || fflush(file) != 0){
+            throw std::runtime_error("Can not write spilled intersections");
+        }
+    }
+};
+
+// Iterates over the intersections of a CompactIntersectionSink in event order,
+// or over a file written by a CompactIntersectionSink with a path after finish().
+// The sink must not be modified while reading.
+//
+//     CompactIntersectionReader reader(sink);
+//     while (reader.next()){
+//         // Use reader.event_point and reader.intersecting_segments
+//     }
+struct CompactIntersectionReader {
+    FILE *file = NULL;
+    bool owns_file = false;
+    const std::string *buffer = NULL;
+    size_t num_intersections = 0;
+
+    Point event_point;
+    SegmentIds intersecting_segments;
+
+    // Bytes are read from the file in chunks and then from the buffer in place
+    std::string chunk;
+    const char *data = NULL;
+    size_t data_size = 0;
+    size_t data_position = 0;
+    long file_position = COMPACT_INTERSECTIONS_HEADER_SIZE;
+    bool reading_buffer = false;
+    size_t num_read = 0;
+
+    CompactIntersectionReader(const CompactIntersectionSink &sink):
+        file(sink.file), buffer(&sink.buffer), num_intersections(sink.num_intersections){}
+
+    // Throws std::runtime_error if the file can not be read or has no valid header
+    CompactIntersectionReader(const std::string &path): owns_file(true){
+        file = fopen(path.c_str(), "rb");
+        if (!file) throw std::runtime_error("Can not open intersection file");
+
+        unsigned char header[COMPACT_INTERSECTIONS_HEADER_SIZE];
+        if (fread(header, 1, sizeof(header), file) != sizeof(header)
+        || !std::equal(COMPACT_INTERSECTIONS_MAGIC, COMPACT_INTERSECTIONS_MAGIC + sizeof(COMPACT_INTERSECTIONS_MAGIC), (const char*)header)){
+            fclose(file);
+            throw std::runtime_error("Invalid intersection file");
+        }
+
+        uint64_t count = 0;
+        for (int i = 0; i < 8; i++) count |= uint64_t(header[sizeof(COMPACT_INTERSECTIONS_MAGIC) + i]) << (8 * i);
+        num_intersections = count;
+    }
+
+    ~CompactIntersectionReader(){
+        if (owns_file) fclose(file);
+    }
+
+    CompactIntersectionReader(const CompactIntersectionReader&) = delete;
+    CompactIntersectionReader& operator = (const CompactIntersectionReader&) = delete;
+
+    int get(){
+        while (data_position == data_size){
+            if (!refill()) return EOF;
+        }
+        return (unsigned char)data[data_position++];
+    }
+
+    bool read(char *out, size_t n){
+        for (size_t i = 0; i < n; i++){
+            int c = get();
+            if (c == EOF) return false;
+            out[i] = c;
+        }
+        return true;
+    }
+
+    bool refill(){
+        if (reading_buffer) return false;
+
+        data_position = 0;
+
+        if (file){
+            chunk.resize(1 << 16);
+            fseek(file, file_position, SEEK_SET);
+            size_t n = fread(&chunk[0], 1, chunk.size(), file);
+            file_position += n;
+            if (n > 0){
+                data = chunk.data();
+                data_size = n;
+                return true;
+            }
+        }
+
+        reading_buffer = true;
+        if (!buffer) return false;
+        data = buffer->data();
+        data_size = buffer->size();
+        return true;
+    }
+
+    // Read the next intersection. Returns false after the last one.
+    bool next(){
+        if (num_read == num_intersections) return false;
+
+        uint64_t header, value;
+        if (!read_varint(*this, header)) return false;
+
+        if (!(header & 1)){
+            if (!read_compact_fraction(*this, event_point.x)) return false;
+        }
+        if (!read_compact_fraction(*this, event_point.y)) return false;
+
+        // The number of segments is untrusted, so only grow as ids arrive
+        intersecting_segments.clear();
+        for (uint64_t i = 0; i < header / 2; i++){
+            if (!read_varint(*this, value)) return false;
+
+            if (i == 0){
+                if (value > UINT32_MAX) return false;
+                intersecting_segments.push_back(value);
+            }else{
+                intersecting_segments.push_back(intersecting_segments.back() + zigzag_decode(value));
+            }
+        }
+
+        num_read++;
+        return true;
+    }
+};
+
+std::vector<Point> find_intersections_sweepline(Segments &segments){
+    IntersectionCallbackDiscardSegments callback;
+
+    find_intersections_sweepline(segments, callback);
+
+    return callback.intersections;
+}
+
+template <typename Coordinate>
+std::vector<Point> find_intersections_sweepline(const SegmentArrays<Coordinate> &segments){
     IntersectionCallbackDiscardSegments callback;
 
     find_intersections_sweepline(segments, callback);
@@ -0,0 +1,205 @@
+"""In-process Python interface to libsweepline.so (see sweepline_c.h).
+
+Segments can be given as any C-contiguous buffer of int64 or float64 values
+with 4 values ax, ay, bx, by per segment (e.g. a NumPy array of shape (n, 4)
+or (n, 2, 2), or an array.array), or as a sequence of ((ax, ay), (bx, by)).
+Writable buffers are passed to the library without copying.
+"""
+import os
+import array
+import ctypes
+from fractions import Fraction
+
+_lib = ctypes.CDLL(os.path.join(os.path.dirname(os.path.abspath(__file__)), "libsweepline.so"))
+
+_c_size_t = ctypes.c_size_t
+_p_int64 = ctypes.POINTER(ctypes.c_int64)
+_p_double = ctypes.POINTER(ctypes.c_double)
+
+for name, argtypes, restype in [
+    ("sweepline_intersect_i64", [ctypes.c_void_p, _c_size_t], ctypes.c_void_p),
+    ("sweepline_intersect_f64", [ctypes.c_void_p, _c_size_t], ctypes.c_void_p),
+    ("sweepline_intersect_rational", [ctypes.c_void_p, ctypes.c_void_p, _c_size_t], ctypes.c_void_p),
+    ("sweepline_num_intersections", [ctypes.c_void_p], _c_size_t),
+    ("sweepline_num_segment_ids", [ctypes.c_void_p], _c_size_t),
+    ("sweepline_offsets", [ctypes.c_void_p], ctypes.POINTER(ctypes.c_uint64)),
+    ("sweepline_segment_ids", [ctypes.c_void_p], ctypes.POINTER(ctypes.c_uint32)),
+    ("sweepline_points_f64", [ctypes.c_void_p, _p_double], None),
+    ("sweepline_points_rational", [ctypes.c_void_p, _p_int64, _p_int64], ctypes.c_int),
+    ("sweepline_point_string", [ctypes.c_void_p, _c_size_t, ctypes.c_char_p, _c_size_t], _c_size_t),
+    ("sweepline_free", [ctypes.c_void_p], None),
+]:
+    function = getattr(_lib, name)
+    function.argtypes = argtypes
+    function.restype = restype
+
+def _as_ctypes_array(data, ctype):
+    """Return ctypes array sharing memory with data if possible."""
+    view = memoryview(data)
+    if not view.c_contiguous or view.itemsize != ctypes.sizeof(ctype):
+        raise ValueError("Segment buffer must be C-contiguous with 8 byte items")
+    num_values = view.nbytes // view.itemsize
+    array_type = ctype * num_values
+    if view.readonly:
+        return array_type.from_buffer_copy(view)
+    return array_type.from_buffer(view)
+
+_INT64_MIN = -2**63
+_INT64_MAX = 2**63 - 1
+
+def _check_int64(values):
+    for value in values:
+        if not _INT64_MIN <= value <= _INT64_MAX:
+            raise OverflowError("Coordinate %d does not fit into int64" % value)
+
+def _buffer_dtype(view):
+    """dtype of a buffer of 8 byte signed integers or doubles."""
+    format = view.format.lstrip("@=<")
+    if view.itemsize == 8 and format in ("q", "l"):
+        return "int64"
+    if view.itemsize == 8 and format == "d":
+        return "float64"
+    raise ValueError("Segment buffer must contain int64 or float64 values, not format %r" % view.format)
+
+def _flatten(segments):
+    return [c for (ax, ay), (bx, by) in segments for c in (ax, ay, bx, by)]
+
+class _Handle:
+    """Owns a SweeplineResult. Arrays pointing into the result keep a
+    reference to it, so it is only freed once nothing uses it anymore."""
+
+    def __init__(self, handle):
+        self.value = handle
+
+    def __del__(self):
+        if self.value:
+            _lib.sweepline_free(self.value)
+            self.value = None
+
+class Intersections:
+    """Result of a sweep. Each group is an intersection point together with
+    the ids (input indices) of all segments going through it.
+
+    offsets and segment_ids are ctypes arrays owned by the library and can
+    be wrapped without copying, e.g. with numpy.frombuffer. They keep the
+    library result alive, also after this object is gone."""
+
+    def __init__(self, handle, inputs):
+        if not handle:
+            raise ValueError("Invalid segments or out of memory")
+        self._owner = _Handle(handle)
+        self._handle = handle
+        # Input buffers must stay alive while the library might access them
+        self._inputs = inputs
+
+        n = _lib.sweepline_num_intersections(handle)
+        num_ids = _lib.sweepline_num_segment_ids(handle)
+        self.offsets = (ctypes.c_uint64 * (n + 1)).from_address(
+            ctypes.addressof(_lib.sweepline_offsets(handle).contents))
+        self.offsets._owner = self._owner
+        if num_ids:
+            self.segment_ids = (ctypes.c_uint32 * num_ids).from_address(
+                ctypes.addressof(_lib.sweepline_segment_ids(handle).contents))
+            self.segment_ids._owner = self._owner
+        else:
+            self.segment_ids = (ctypes.c_uint32 * 0)()
+
+    def __len__(self):
+        return len(self.offsets) - 1
+
+    def points_float(self, out=None):
+        """Intersection points as flat float64 buffer x0, y0, x1, y1, ...
+
+        out can be a writable C-contiguous float64 buffer with at least
+        2 * len(self) items, else ValueError is raised."""
+        if out is None:
+            out = array.array("d", bytes(16 * len(self)))
+        else:
+            view = memoryview(out)
+            if _buffer_dtype(view) != "float64" or view.readonly:
+                raise ValueError("Output buffer must be a writable float64 buffer")
+            if view.nbytes // view.itemsize < 2 * len(self):
+                raise ValueError("Output buffer needs at least %d items" % (2 * len(self)))
+        _lib.sweepline_points_f64(self._handle, _as_ctypes_array(out, ctypes.c_double))
+        return out
+
+    def points(self):
+        """Exact intersection points as list of (Fraction, Fraction)."""
+        n = len(self)
+        numerators = (ctypes.c_int64 * (2 * n))()
+        denominators = (ctypes.c_int64 * (2 * n))()
+        if _lib.sweepline_points_rational(self._handle, numerators, denominators) == 0:
+            return [(Fraction(numerators[2 * i], denominators[2 * i]),
+                Fraction(numerators[2 * i + 1], denominators[2 * i + 1]))
+                for i in range(n)]
+
+        # Values too large for int64, fall back to text
+        points = []
+        for i in range(n):
+            size = _lib.sweepline_point_string(self._handle, i, None, 0)
+            buffer = ctypes.create_string_buffer(size)
+            _lib.sweepline_point_string(self._handle, i, buffer, size)
+            x, y = buffer.value.decode("ascii").split()
+            points.append((Fraction(x), Fraction(y)))
+        return points
+
+    def groups(self):
+        """Iterate over (point, list of segment ids)."""
+        for i, point in enumerate(self.points()):
+            yield point, list(self.segment_ids[self.offsets[i]:self.offsets[i + 1]])
+
+def find_intersections(segments, dtype=None):
+    """Find all intersections between segments.
+
+    dtype can be "int64" or "float64". If segments is a buffer, dtype is
+    derived from its format, other formats raise ValueError. Sequences of
+    Fraction are passed as rationals. Integers, numerators and denominators
+    outside of int64 raise OverflowError."""
+    try:
+        view = memoryview(segments)
+    except TypeError:
+        view = None
+
+    if view is not None:
+        buffer_dtype = _buffer_dtype(view)
+        if dtype is None:
+            dtype = buffer_dtype
+        elif dtype != buffer_dtype:
+            raise ValueError("Segment buffer contains %s values, not %s" % (buffer_dtype, dtype))
+        ctype = ctypes.c_double if dtype == "float64" else ctypes.c_int64
+        data = _as_ctypes_array(segments, ctype)
+        if len(data) % 4 != 0:
+            raise ValueError("Segment buffer length must be a multiple of 4")
+        num_segments = len(data) // 4
+    else:
+        values = _flatten(segments)
+        num_segments = len(values) // 4
+
+        if dtype is None:
+            if all(isinstance(value, int) for value in values):
+                dtype = "int64"
+            elif all(isinstance(value, float) for value in values):
+                dtype = "float64"
+            else:
+                dtype = "rational"
+
+        if dtype == "rational":
+            values = [Fraction(value) for value in values]
+            _check_int64(v.numerator for v in values)
+            _check_int64(v.denominator for v in values)
+            numerators = (ctypes.c_int64 * len(values))(*(v.numerator for v in values))
+            denominators = (ctypes.c_int64 * len(values))(*(v.denominator for v in values))
+            handle = _lib.sweepline_intersect_rational(numerators, denominators, num_segments)
+            return Intersections(handle, (numerators, denominators))
+
+        if dtype == "int64":
+            _check_int64(values)
+        ctype = ctypes.c_double if dtype == "float64" else ctypes.c_int64
+        data = (ctype * len(values))(*values)
+
+    if dtype == "float64":
+        handle = _lib.sweepline_intersect_f64(data, num_segments)
+    else:
+        handle = _lib.sweepline_intersect_i64(data, num_segments)
+
+    return Intersections(handle, data)
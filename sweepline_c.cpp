@@ -0,0 +1,202 @@
+#include "sweepline_c.h"
+#include "sweepline.hpp"
+#include <math.h>
+#include <string.h>
+#include <new>
+#include <string>
+
+struct SweeplineResult {
+    Points points;
+    std::vector<uint64_t> offsets;
+    SegmentIds segment_ids;
+
+    SweeplineResult(): offsets(1, 0){}
+
+    void operator () (
+        const Point &intersection,
+        const SegmentIds &ids
+    ){
+        points.push_back(intersection);
+        segment_ids.insert(segment_ids.end(), ids.begin(), ids.end());
+        offsets.push_back(segment_ids.size());
+    }
+};
+
+// Views of flat arrays with 4 coordinates per segment
+template <typename Coordinate>
+struct InterleavedSegments {
+    const Coordinate *coordinates;
+    size_t num_segments;
+
+    InterleavedSegments(const Coordinate *coordinates, size_t num_segments):
+        coordinates(coordinates), num_segments(num_segments){}
+
+    size_t size() const {
+        return num_segments;
+    }
+
+    Point a(SegmentId id) const {
+        return Point(Fraction(coordinates[4 * size_t(id) + 0]), Fraction(coordinates[4 * size_t(id) + 1]));
+    }
+
+    Point b(SegmentId id) const {
+        return Point(Fraction(coordinates[4 * size_t(id) + 2]), Fraction(coordinates[4 * size_t(id) + 3]));
+    }
+};
+
+struct InterleavedRationalSegments {
+    const int64_t *numerators;
+    const int64_t *denominators;
+    size_t num_segments;
+
+    InterleavedRationalSegments(const int64_t *numerators, const int64_t *denominators, size_t num_segments):
+        numerators(numerators), denominators(denominators), num_segments(num_segments){}
+
+    size_t size() const {
+        return num_segments;
+    }
+
+    Fraction coordinate(size_t i) const {
+        mpq_class x(mpz_class(numerators[i]), mpz_class(denominators[i]));
+        x.canonicalize();
+        return Fraction(x);
+    }
+
+    Point a(SegmentId id) const {
+        return Point(coordinate(4 * size_t(id) + 0), coordinate(4 * size_t(id) + 1));
+    }
+
+    Point b(SegmentId id) const {
+        return Point(coordinate(4 * size_t(id) + 2), coordinate(4 * size_t(id) + 3));
+    }
+};
+
+template <typename SEGMENTS>
+SweeplineResult* intersect(const SEGMENTS &segments){
+    if (segments.size() > UINT32_MAX) return NULL;
+
+    SweeplineResult *result = NULL;
+    try {
+        result = new SweeplineResult();
+
+        find_intersections_sweepline_ids(segments, *result);
+    }catch (...){
+        delete result;
+        return NULL;
+    }
+    return result;
+}
+
+// mpq_get_d truncates, so compare with the next double away from zero
+double to_nearest_double(const mpq_class &x){
+    double d = x.get_d();
+    if (mpq_class(d) == x) return d;
+
+    double other = nextafter(d, sgn(x) < 0 ? -INFINITY : INFINITY);
+    if (!isfinite(other)) return d;
+
+    mpq_class error = abs(x - mpq_class(d));
+    mpq_class other_error = abs(mpq_class(other) - x);
+    if (error < other_error) return d;
+    if (other_error < error) return other;
+
+    // Ties to even
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return (bits & 1) ? other : d;
+}
+
+bool to_int64(const mpz_class &x, int64_t &value){
+    if (!x.fits_slong_p() || sizeof(long) < sizeof(int64_t)) return false;
+    value = x.get_si();
+    return true;
+}
+
+extern "C" {
+
+SweeplineResult* sweepline_intersect_i64(const int64_t *segments, size_t num_segments){
+    return intersect(InterleavedSegments<int64_t>(segments, num_segments));
+}
+
+SweeplineResult* sweepline_intersect_f64(const double *segments, size_t num_segments){
+    for (size_t i = 0; i < 4 * num_segments; i++){
+        if (!isfinite(segments[i])) return NULL;
+    }
+
+    return intersect(InterleavedSegments<double>(segments, num_segments));
+}
+
+SweeplineResult* sweepline_intersect_rational(
+    const int64_t *numerators,
+    const int64_t *denominators,
+    size_t num_segments
+){
+    for (size_t i = 0; i < 4 * num_segments; i++){
+        if (denominators[i] == 0) return NULL;
+    }
+
+    return intersect(InterleavedRationalSegments(numerators, denominators, num_segments));
+}
+
+size_t sweepline_num_intersections(const SweeplineResult *result){
+    return result->points.size();
+}
+
+size_t sweepline_num_segment_ids(const SweeplineResult *result){
+    return result->segment_ids.size();
+}
+
+const uint64_t* sweepline_offsets(const SweeplineResult *result){
+    return result->offsets.data();
+}
+
+const uint32_t* sweepline_segment_ids(const SweeplineResult *result){
+    return result->segment_ids.data();
+}
+
+void sweepline_points_f64(const SweeplineResult *result, double *points){
+    for (size_t i = 0; i < result->points.size(); i++){
+        points[2 * i + 0] = to_nearest_double(to_mpq(result->points[i].x));
+        points[2 * i + 1] = to_nearest_double(to_mpq(result->points[i].y));
+    }
+}
+
+int sweepline_points_rational(
+    const SweeplineResult *result,
+    int64_t *numerators,
+    int64_t *denominators
+){
+    for (size_t i = 0; i < result->points.size(); i++){
+        const mpq_class &x = to_mpq(result->points[i].x);
+        const mpq_class &y = to_mpq(result->points[i].y);
+
+        if (!to_int64(x.get_num(), numerators[2 * i + 0])) return -1;
+        if (!to_int64(x.get_den(), denominators[2 * i + 0])) return -1;
+        if (!to_int64(y.get_num(), numerators[2 * i + 1])) return -1;
+        if (!to_int64(y.get_den(), denominators[2 * i + 1])) return -1;
+    }
+    return 0;
+}
+
+size_t sweepline_point_string(
+    const SweeplineResult *result,
+    size_t i,
+    char *buffer,
+    size_t size
+){
+    const Point &p = result->points[i];
+
+    std::string s = to_mpq(p.x).get_str() + " " + to_mpq(p.y).get_str();
+
+    if (s.size() + 1 <= size){
+        memcpy(buffer, s.c_str(), s.size() + 1);
+    }
+
+    return s.size() + 1;
+}
+
+void sweepline_free(SweeplineResult *result){
+    delete result;
+}
+
+}
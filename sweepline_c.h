@@ -0,0 +1,70 @@
+#pragma once
+
+/* C interface to the sweepline algorithm, compiled into libsweepline.so.
+ *
+ * Segments are passed as flat arrays of 4 * num_segments coordinates
+ * ax, ay, bx, by, ax, ay, ... (e.g. a C-contiguous NumPy array of shape
+ * (num_segments, 4) or (num_segments, 2, 2)). The input is not copied.
+ *
+ * The result contains one group per intersection point. Group i consists of
+ * the segment ids segment_ids[offsets[i]] to segment_ids[offsets[i + 1] - 1],
+ * where a segment id is the index of the segment in the input array.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define SWEEPLINE_API __declspec(dllexport)
+#else
+#define SWEEPLINE_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SweeplineResult SweeplineResult;
+
+/* Return NULL on invalid input (non-finite doubles, zero denominators) or
+ * if memory allocation failed. */
+SWEEPLINE_API SweeplineResult* sweepline_intersect_i64(const int64_t *segments, size_t num_segments);
+SWEEPLINE_API SweeplineResult* sweepline_intersect_f64(const double *segments, size_t num_segments);
+SWEEPLINE_API SweeplineResult* sweepline_intersect_rational(
+    const int64_t *numerators,
+    const int64_t *denominators,
+    size_t num_segments);
+
+SWEEPLINE_API size_t sweepline_num_intersections(const SweeplineResult *result);
+SWEEPLINE_API size_t sweepline_num_segment_ids(const SweeplineResult *result);
+
+/* Arrays owned by the result, valid until sweepline_free is called.
+ * offsets has num_intersections + 1 entries. */
+SWEEPLINE_API const uint64_t* sweepline_offsets(const SweeplineResult *result);
+SWEEPLINE_API const uint32_t* sweepline_segment_ids(const SweeplineResult *result);
+
+/* Write intersection points x0, y0, x1, y1, ... into caller-provided arrays
+ * of 2 * num_intersections entries. Points are rounded to the nearest double. */
+SWEEPLINE_API void sweepline_points_f64(const SweeplineResult *result, double *points);
+
+/* Exact version of sweepline_points_f64. Returns 0 on success and -1 if a
+ * numerator or denominator does not fit into int64. */
+SWEEPLINE_API int sweepline_points_rational(
+    const SweeplineResult *result,
+    int64_t *numerators,
+    int64_t *denominators);
+
+/* Write the exact point i as "x y" with x and y formatted like "-3/4" into
+ * buffer. Returns the buffer size required including the terminating zero,
+ * the output is only written if size is large enough. */
+SWEEPLINE_API size_t sweepline_point_string(
+    const SweeplineResult *result,
+    size_t i,
+    char *buffer,
+    size_t size);
+
+SWEEPLINE_API void sweepline_free(SweeplineResult *result);
+
+#ifdef __cplusplus
+}
+#endif
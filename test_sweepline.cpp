@@ -0,0 +1,460 @@
+// Tests of features which are not covered by comparing ./main with the naive
+// algorithm in test_sweepline.py, which runs this program. Each test compares
+// against brute force and returns false on the first mismatch.
+#include "sweepline.hpp"
+#include "small_fraction.hpp"
+#include <sstream>
+
+typedef std::vector<std::pair<Point, SegmentIds>> Intersections;
+
+// Collect intersections of a sweep, saving a snapshot after the given number
+// of intersections and continuing from that snapshot in a new Sweepline.
+template <typename SEGMENTS>
+Intersections sweep_with_checkpoint(const SEGMENTS &segments, size_t checkpoint, bool linear_event_queue){
+    Intersections intersections;
+    std::stringstream snapshot;
+
+    {
+        Sweepline<SEGMENTS> sweep(segments, linear_event_queue);
+
+        while (intersections.size() < checkpoint && sweep.next()){
+            intersections.emplace_back(sweep.event_point, sweep.intersecting_segments);
+        }
+
+        sweep.save(snapshot);
+    }
+
+    Sweepline<SEGMENTS> sweep(segments);
+
+    if (!sweep.load(snapshot)) return Intersections();
+
+    while (sweep.next()){
+        intersections.emplace_back(sweep.event_point, sweep.intersecting_segments);
+    }
+
+    return intersections;
+}
+
+bool test_checkpoint(){
+    for (int test = 0; test < 50; test++){
+        SegmentArrays<int64_t> segments;
+
+        for (int i = 0; i < test; i++){
+            segments.push_back(rand() % 10, rand() % 10, rand() % 10, rand() % 10);
+        }
+
+        Intersections expected = sweep_with_checkpoint(segments, SIZE_MAX, false);
+
+        size_t stride = expected.size() / 10 + 1;
+
+        for (size_t checkpoint = 0; checkpoint <= expected.size(); checkpoint += stride){
+            for (bool linear_event_queue : {false, true}){
+                Intersections intersections = sweep_with_checkpoint(segments, checkpoint, linear_event_queue);
+
+                if (intersections != expected){
+                    std::cout << "Resuming after " << checkpoint << " intersections of " << segments.size() << " segments failed";
+                    std::cout << (linear_event_queue ? " with linear event queue" : "") << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+
+    // Corrupt snapshots must be rejected without allocating their claimed sizes
+    SegmentArrays<int64_t> segments;
+    segments.push_back(0, 0, 1, 1);
+    Sweepline<SegmentArrays<int64_t>> sweep(segments);
+
+    std::string huge_integer("SWP3\x01\x00\xff\xff\xff\xff\xff\xff\xff\xff\x7f", 15);
+    for (const std::string &data : {huge_integer, std::string("SWP3"), std::string("SWP2")}){
+        std::istringstream in(data);
+        if (sweep.load(in)){
+            std::cout << "Loaded corrupt snapshot" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Returns the number of intersections read, or -1 if they differ
+long compare_compact_intersections(CompactIntersectionReader &reader, const Intersections &intersections){
+    size_t i = 0;
+    for (; reader.next(); i++){
+        if (i >= intersections.size()
+        || reader.event_point != intersections[i].first
+        || reader.intersecting_segments != intersections[i].second){
+            std::cout << "Intersection " << i << " differs" << std::endl;
+            return -1;
+        }
+    }
+    return i;
+}
+
+struct IntersectionCollector {
+    Intersections intersections;
+
+    void operator () (
+        const Point &intersection,
+        const SegmentIds &segment_ids
+    ){
+        intersections.emplace_back(intersection, segment_ids);
+    }
+};
+
+bool test_compact_sink(){
+    SegmentArrays<int64_t> segments;
+
+    for (int i = 0; i < 300; i++){
+        segments.push_back(rand() % 1000, rand() % 1000, rand() % 1000, rand() % 1000);
+    }
+
+    // Also store a few intersections with coordinates which do not fit into 64 bits
+    segments.push_back(-1, 0, INT64_MAX, 1);
+    segments.push_back(-1, 1, INT64_MAX, 0);
+
+    IntersectionCollector collector;
+    find_intersections_sweepline(segments, collector);
+    long expected = collector.intersections.size();
+
+    // Tiny memory budget to spill to a temporary file frequently
+    CompactIntersectionSink sink(1000);
+    find_intersections_sweepline(segments, sink);
+
+    CompactIntersectionReader reader(sink);
+    long num_read = compare_compact_intersections(reader, collector.intersections);
+    if (num_read != expected){
+        std::cout << "Read " << num_read << " of " << expected << " intersections" << std::endl;
+        return false;
+    }
+
+    // Write to a file which can be read after the sink is gone
+    const char *path = "test_compact_sink.bin";
+    {
+        CompactIntersectionSink file_sink(1000, path);
+        find_intersections_sweepline(segments, file_sink);
+        file_sink.finish();
+    }
+
+    {
+        CompactIntersectionReader file_reader(path);
+        num_read = compare_compact_intersections(file_reader, collector.intersections);
+    }
+
+    if (num_read != expected){
+        std::cout << "Read " << num_read << " of " << expected << " intersections from file" << std::endl;
+        std::remove(path);
+        return false;
+    }
+
+    // Corrupt file claiming a huge number of segment ids for an intersection
+    FILE *file = fopen(path, "wb");
+    const char corrupt[] = "SWI1\x01\0\0\0\0\0\0\0\xfe\xff\xff\xff\xff\xff\xff\xff\x7f\x01\x00\x01\x00\x05";
+    fwrite(corrupt, 1, sizeof(corrupt) - 1, file);
+    fclose(file);
+
+    bool ok;
+    {
+        CompactIntersectionReader corrupt_reader(path);
+        ok = !corrupt_reader.next();
+    }
+    std::remove(path);
+
+    if (!ok) std::cout << "Read corrupt intersection file" << std::endl;
+
+    return ok;
+}
+
+struct ClearancePairs {
+    std::vector<std::pair<SegmentId, SegmentId>> pairs;
+
+    void operator () (
+        SegmentId i,
+        SegmentId j,
+        const Point &p,
+        const Point &q,
+        const Fraction &squared_distance
+    ){
+        (void)p;
+        (void)q;
+        (void)squared_distance;
+        pairs.emplace_back(i, j);
+    }
+};
+
+bool test_clearance(){
+    for (int test = 0; test < 200; test++){
+        SegmentArrays<int64_t> segments;
+
+        int n = test % 50;
+        for (int i = 0; i < n; i++){
+            segments.push_back(rand() % 100, rand() % 100, rand() % 100, rand() % 100);
+        }
+
+        Fraction distance(test % 7);
+        if (test % 3 == 0) distance /= 3;
+
+        ClearancePairs callback;
+        find_segments_within_distance(segments, distance, callback);
+
+        // Without candidates from bounding boxes, all come from the sweep
+        ClearancePairs sweep_callback;
+        find_segments_within_distance(segments, distance, sweep_callback, 0);
+
+        // Compare with all pairs
+        std::vector<std::pair<SegmentId, SegmentId>> expected;
+        OrientedSegments<SegmentArrays<int64_t>> oriented(segments);
+        for (SegmentId i = 0; i < segments.size(); i++){
+            for (SegmentId j = i + 1; j < segments.size(); j++){
+                Point p, q;
+                Fraction d2 = squared_distance_two_segments(oriented.start(i), oriented.end(i), oriented.start(j), oriented.end(j), p, q);
+
+                if (d2 <= distance * distance) expected.emplace_back(i, j);
+            }
+        }
+
+        if (callback.pairs != expected || sweep_callback.pairs != expected){
+            std::cout << "Found " << callback.pairs.size() << " and " << sweep_callback.pairs.size() << " instead of " << expected.size() << " pairs within distance " << distance << std::endl;
+            return false;
+        }
+    }
+
+    // Long parallel diagonals have overlapping bounding boxes, but none are
+    // within distance. This must not test all pairs.
+    SegmentArrays<int64_t> diagonals;
+    for (int i = 0; i < 4000; i++){
+        diagonals.push_back(10 * i, 0, 10 * i + 100000, 100000);
+    }
+    diagonals.push_back(5, 4, 100005, 100004);
+
+    ClearancePairs diagonal_callback;
+    find_segments_within_distance(diagonals, 1, diagonal_callback);
+
+    if (diagonal_callback.pairs != std::vector<std::pair<SegmentId, SegmentId>>{{0, 4000}}){
+        std::cout << "Found " << diagonal_callback.pairs.size() << " pairs of diagonals instead of 1" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Height at which the vertical line through p hits segment id, clamped to
+// p.y for vertical segments reaching p. Returns false if it is not hit.
+bool hit_y(const OrientedSegments<SegmentArrays<int64_t>> &segments, SegmentId id, const Point &p, Fraction &y){
+    Segment seg = segments.segment(id);
+
+    if (!between(seg.a.x, p.x, seg.b.x)) return false;
+
+    if (seg.is_vertical()){
+        if (p.y < seg.a.y){
+            y = seg.a.y;
+        }else{
+            y = std::min(seg.b.y, p.y);
+        }
+    }else{
+        y = seg.a.y + seg.slope() * (p.x - seg.a.x);
+    }
+    return true;
+}
+
+bool test_point_location(){
+    for (int test = 0; test < 100; test++){
+        SegmentArrays<int64_t> segments;
+
+        int n = test % 40;
+        int range = 2 + test % 20;
+        for (int i = 0; i < n; i++){
+            int64_t ax = rand() % range, ay = rand() % range;
+            if (i % 5 == 0){
+                segments.push_back(ax, ay, ax, rand() % range);
+            }else{
+                segments.push_back(ax, ay, rand() % range, rand() % range);
+            }
+        }
+
+        VerticalDecomposition<SegmentArrays<int64_t>> decomposition(segments);
+        OrientedSegments<SegmentArrays<int64_t>> oriented(segments);
+
+        // Query points on a grid which includes all end points
+        Points points;
+        for (int x = -2; x <= 2 * range; x++){
+            for (int y = -2; y <= 2 * range; y++){
+                points.emplace_back(Fraction(x) / 2, Fraction(y) / 2);
+            }
+        }
+
+        std::vector<PointLocation> results;
+        decomposition.locate(points, results, 4);
+
+        for (size_t i = 0; i < points.size(); i++){
+            const Point &p = points[i];
+            PointLocation result = decomposition.locate(p);
+
+            if (result.below != results[i].below || result.above != results[i].above){
+                std::cout << "Batched query differs at " << p << std::endl;
+                return false;
+            }
+
+            // Compare heights with all segments
+            bool has_below = false, has_above = false;
+            Fraction below_y, above_y, y;
+            for (SegmentId id = 0; id < segments.size(); id++){
+                if (!hit_y(oriented, id, p, y)) continue;
+
+                if (y <= p.y && (!has_below || y > below_y)){
+                    has_below = true;
+                    below_y = y;
+                }
+                if (y > p.y && (!has_above || y < above_y)){
+                    has_above = true;
+                    above_y = y;
+                }
+            }
+
+            bool ok = (result.below != NO_SEGMENT) == has_below && (result.above != NO_SEGMENT) == has_above;
+            if (ok && has_below){
+                ok = hit_y(oriented, result.below, p, y) && y == below_y && result.on_segment == (below_y == p.y);
+            }
+            if (ok && has_above){
+                ok = hit_y(oriented, result.above, p, y) && y == above_y;
+            }
+
+            if (!ok){
+                std::cout << "Wrong location of " << p << " in test " << test << std::endl;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool test_unsigned_coordinates(){
+    // Coordinates near UINT32_MAX must give the same intersections as the
+    // same segments shifted into int64_t
+    SegmentArrays<uint32_t> segments;
+    SegmentArrays<int64_t> shifted;
+    uint32_t offset = UINT32_MAX - 1000;
+
+    for (int i = 0; i < 100; i++){
+        uint32_t ax = rand() % 1000, ay = rand() % 1000, bx = rand() % 1000, by = rand() % 1000;
+        segments.push_back(offset + ax, offset + ay, offset + bx, offset + by);
+        shifted.push_back(ax, ay, bx, by);
+    }
+
+    IntersectionCollector collector;
+    find_intersections_sweepline(segments, collector);
+
+    IntersectionCollector expected;
+    find_intersections_sweepline(shifted, expected);
+
+    if (collector.intersections.size() != expected.intersections.size()){
+        std::cout << "Found " << collector.intersections.size() << " instead of " << expected.intersections.size() << " intersections" << std::endl;
+        return false;
+    }
+
+    for (size_t i = 0; i < collector.intersections.size(); i++){
+        Point p = expected.intersections[i].first;
+        p.x += offset;
+        p.y += offset;
+
+        if (collector.intersections[i].first != p || collector.intersections[i].second != expected.intersections[i].second){
+            std::cout << "Intersection " << i << " differs" << std::endl;
+            return false;
+        }
+    }
+
+    // Values above INT64_MAX do not fit inline
+    if (Fraction(UINT64_MAX) - Fraction(INT64_MAX) != Fraction(uint64_t(INT64_MAX) + 1)){
+        std::cout << "Wrong conversion of UINT64_MAX" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Random value which is often close to the limits of the inline representation
+mpq_class random_mpq(const std::vector<mpq_class> &previous){
+    static const int64_t limits[] = {0, 1, 2, INT64_MAX, INT64_MIN, INT64_MAX / 2, INT64_MIN / 2, INT64_C(1) << 62, -(INT64_C(1) << 62), INT64_C(3037000499)};
+
+    if (!previous.empty() && rand() % 3 == 0) return previous[rand() % previous.size()];
+
+    mpz_class num(long(limits[rand() % 10]));
+    mpz_class den(long(limits[rand() % 4]));
+    num += rand() % 7 - 3;
+    den += rand() % 7 - 3;
+    if (den == 0) den = 1;
+
+    mpq_class q(num, den);
+    q.canonicalize();
+    return q;
+}
+
+bool test_small_fraction(){
+    // SmallFraction must give the same results as mpq_class and store every
+    // value inline which fits
+    std::vector<mpq_class> previous;
+
+    for (int test = 0; test < 100000; test++){
+        mpq_class a = random_mpq(previous);
+        mpq_class b = random_mpq(previous);
+        SmallFraction x(a), y(b);
+
+        mpq_class expected;
+        SmallFraction result;
+        int op = rand() % 5;
+        switch (op){
+            case 0: expected = a + b; result = x + y; break;
+            case 1: expected = a - b; result = x - y; break;
+            case 2: expected = a * b; result = x * y; break;
+            case 3: expected = b == 0 ? a : a / b; result = y == 0 ? x : x / y; break;
+            case 4: expected = -a; result = -x; break;
+        }
+
+        bool fits = expected.get_num().fits_slong_p() && expected.get_den().fits_slong_p() && expected.get_num() != long(INT64_MIN);
+
+        if (result.get_mpq() != expected || result.is_small() != fits){
+            std::cout << "Operation " << op << " on " << a << " and " << b << " gave " << result << " instead of " << expected << std::endl;
+            return false;
+        }
+
+        if ((x < y) != (a < b) || (x == y) != (a == b) || x.sign() != sgn(a)){
+            std::cout << "Comparison of " << a << " and " << b << " differs" << std::endl;
+            return false;
+        }
+
+        // Keep values from growing without bound
+        if (mpz_sizeinbase(expected.get_num_mpz_t(), 2) + mpz_sizeinbase(expected.get_den_mpz_t(), 2) > 512) continue;
+
+        if (previous.size() < 1000) previous.push_back(expected);
+        else previous[rand() % previous.size()] = expected;
+    }
+
+    return true;
+}
+
+int main(){
+    srand(0);
+
+    struct {
+        const char *name;
+        bool (*run)();
+    } tests[] = {
+        {"checkpoint", test_checkpoint},
+        {"compact_sink", test_compact_sink},
+        {"clearance", test_clearance},
+        {"point_location", test_point_location},
+        {"unsigned_coordinates", test_unsigned_coordinates},
+        {"small_fraction", test_small_fraction},
+    };
+
+    for (const auto &test : tests){
+        if (!test.run()){
+            std::cout << "Test " << test.name << " failed" << std::endl;
+            return 1;
+        }
+        std::cout << "Passed test " << test.name << std::endl;
+    }
+
+    return 0;
+}
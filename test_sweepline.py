@@ -91,6 +91,22 @@ def make_random_segments(num_segments, max_x, max_y):
 
     return segments
 
+def make_random_orthogonal_segments(num_segments, max_x, max_y):
+    segments = []
+
+    for _ in range(num_segments):
+        ax = random.randrange(max_x)
+        ay = random.randrange(max_y)
+
+        if random.random() < 0.5:
+            b = (random.randrange(max_x), ay)
+        else:
+            b = (ax, random.randrange(max_y))
+
+        segments.append(((ax, ay), b))
+
+    return segments
+
 def find_intersections_naive(segments):
     result = collections.defaultdict(set)
 
@@ -104,12 +120,29 @@ def find_intersections_naive(segments):
     return {intersection: sorted(sorted(segments[i]) for i in indices)
         for intersection, indices in result.items()}
 
-def find_intersections(segments):
+def find_intersections_library(segments):
+    # Run in-process through libsweepline.so
+    import sweepline
+
+    result = {}
+
+    for intersection, segment_ids in sweepline.find_intersections(segments).groups():
+        intersecting_segments = sorted(sorted(segments[i]) for i in segment_ids)
+
+        assert intersection not in result
+
+        result[intersection] = intersecting_segments
+
+    return result
+
+def find_intersections(segments, general=False, program="./main"):
+    # general forces the general sweep instead of the orthogonal one
     result = {}
 
     text_segments = "\n".join(f"{ax} {ay} {bx} {by}\n"
         for (ax, ay), (bx, by) in segments).encode("utf-8")
-    process = subprocess.run(["./main"], input=text_segments, capture_output=True)
+    command = [program, "--general"] if general else [program]
+    process = subprocess.run(command, input=text_segments, capture_output=True)
     for block in process.stdout.decode("utf-8").strip().split("\n\n")[1:]:
         lines = block.split("\n")
 
@@ -204,10 +237,14 @@ def test_simple(num_tests):
         expected_result = find_intersections_naive(segments)
 
         result = find_intersections(segments)
+        general_result = find_intersections(segments, general=True)
+        library_result = find_intersections_library(segments)
 
         assert sorted(expected_result.keys()) == expected_intersections
         assert sorted(result.keys()) == expected_intersections
         assert result == expected_result
+        assert general_result == expected_result
+        assert library_result == expected_result
 
         num_tests += 1
         print("Passed test", num_tests)
@@ -222,14 +259,148 @@ def test_random(num_tests):
         expected_result = find_intersections_naive(segments)
 
         result = find_intersections(segments)
+        library_result = find_intersections_library(segments)
+
+        assert result == expected_result
+        assert library_result == expected_result
+
+        num_tests += 1
+        print(f"Passed test {num_tests}")
+
+    return num_tests
+
+def test_random_orthogonal(num_tests):
+    for num_segments in range(100):
+        segments = make_random_orthogonal_segments(
+            num_segments=num_segments, max_x=10, max_y=10)
+
+        expected_result = find_intersections_naive(segments)
+
+        result = find_intersections(segments)
+        general_result = find_intersections(segments, general=True)
+        library_result = find_intersections_library(segments)
 
         assert result == expected_result
+        assert general_result == expected_result
+        assert library_result == expected_result
 
         num_tests += 1
         print(f"Passed test {num_tests}")
 
     return num_tests
 
+def test_mpq(num_tests):
+    # SmallFraction must give the same results as mpq_class, also for
+    # coordinates where intermediate values do not fit into 64 bits
+    for num_segments in range(100):
+        max_x = random.choice([10, 2**31, 2**62])
+        segments = make_random_segments(
+            num_segments=num_segments, max_x=max_x, max_y=max_x)
+
+        result = find_intersections(segments)
+        mpq_result = find_intersections(segments, program="./main_mpq")
+
+        assert result == mpq_result
+
+        num_tests += 1
+        print(f"Passed test {num_tests}")
+
+    return num_tests
+
+def test_library_interface(num_tests):
+    import array
+    import gc
+    import sweepline
+
+    segments = [((0, 0), (2, 2)), ((0, 2), (2, 0)), ((0, 1), (3, 1))]
+
+    # Arrays must keep the result alive
+    offsets = sweepline.find_intersections(segments).offsets
+    segment_ids = sweepline.find_intersections(segments).segment_ids
+    gc.collect()
+    sweepline.find_intersections(make_random_segments(50, 10, 10))
+    assert list(offsets) == [0, 3]
+    assert sorted(segment_ids) == [0, 1, 2]
+
+    # Coordinates which do not fit into int64 must not wrap around
+    for bad_segments in [
+        [((0, 0), (2**70, 2)), ((0, 2), (2, 0))],
+        [((0, 0), (Fraction(1, 2**70), 2)), ((0, 2), (2, 0))],
+    ]:
+        try:
+            sweepline.find_intersections(bad_segments)
+            assert False
+        except OverflowError:
+            pass
+
+    # Only int64 and float64 buffers are accepted
+    for typecode in "QiIf":
+        try:
+            sweepline.find_intersections(array.array(typecode, [0, 0, 2, 2, 0, 2, 2, 0]))
+            assert False
+        except ValueError:
+            pass
+
+    result = sweepline.find_intersections(array.array("q", [0, 0, 1, 1, 0, 1, 10, 0]))
+    assert list(result.points_float()) == [10 / 11, 10 / 11]
+
+    # Output buffers must be float64 and large enough
+    result = sweepline.find_intersections(array.array("q", [0, 0, 2, 2, 0, 2, 2, 0, 0, 0, 0, 2]))
+    assert len(result) == 3
+    for out in [array.array("d", [0.0]), array.array("q", [0] * 4), bytes(32)]:
+        try:
+            result.points_float(out)
+            assert False
+        except ValueError:
+            pass
+    out = array.array("d", [-1.0] * 7)
+    assert result.points_float(out) is out
+    assert list(out) == [0.0, 0.0, 0.0, 2.0, 1.0, 1.0, -1.0]
+
+    # Buffers must contain whole segments
+    try:
+        sweepline.find_intersections(array.array("q", [0, 0, 2, 2, 0, 2, 2]))
+        assert False
+    except ValueError:
+        pass
+
+    num_tests += 1
+    print(f"Passed test {num_tests}")
+
+    return num_tests
+
+def test_features(num_tests):
+    # test_sweepline.cpp compares other features against brute force
+    process = subprocess.run(["./test_sweepline"], capture_output=True)
+    output = process.stdout.decode("utf-8")
+    assert process.returncode == 0, output
+
+    for line in output.strip().split("\n"):
+        num_tests += 1
+        print(f"Passed test {num_tests} ({line.split()[-1]})")
+
+    return num_tests
+
+def test_examples(num_tests):
+    # Examples must run without errors
+    for example in [
+        "example_segments",
+        "example_intersections",
+        "example_segment_ids",
+        "example_next_intersection",
+        "example_checkpoint",
+        "example_compact_sink",
+        "example_clearance",
+        "example_point_location",
+    ]:
+        process = subprocess.run(["./" + example], capture_output=True)
+        assert process.returncode == 0, process.stdout.decode("utf-8")
+
+        num_tests += 1
+        print(f"Passed test {num_tests} ({example})")
+
+    return num_tests
+
 def main():
     print(subprocess.check_output(["make"]).decode("utf-8"))
 
@@ -238,6 +409,11 @@ def main():
     num_tests = 0
     num_tests = test_simple(num_tests)
     num_tests = test_random(num_tests)
+    num_tests = test_random_orthogonal(num_tests)
+    num_tests = test_mpq(num_tests)
+    num_tests = test_library_interface(num_tests)
+    num_tests = test_features(num_tests)
+    num_tests = test_examples(num_tests)
 
     print(f"Passed all {num_tests} tessed")
 